@@ -6,169 +6,753 @@
  */
 
 #include "bb.h"
-#include "heap.h"
+#include "checkpoint.h"
+#include "deque.h"
+#include "dp.h"
+#include "incumbent.h"
+#include "mqueue.h"
+#include "path.h"
+#include "pool.h"
 #include "prim.h"
+#include "reduce.h"
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 // Useful macros
 #define START 0
 #define TARGET START
-#define DIST(a, b) (distances[(a)*n + (b)])
+#define DIST(a, b) graph_distance (graph, a, b)
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #define MAX(a, b) (((a) < (b)) ? (b) : (a))
 
 /*
- * Branch the node for a new city i.
+ * Iterations of the Held-Karp ascent at the root, and for the other nodes,
+ * which start from the penalties of their parent.
  */
-static inline void
-bb_branch (Heap *restrict heap, Pheap *restrict pheap,
-           const Distance *restrict distances, const size_t n,
-           Distance *best_tour, const Node *restrict node,
-           const City next_city, Distance *restrict _tmp1,
-           City *restrict _tmp2)
+#define ROOT_ITERATIONS 100
+#define NODE_ITERATIONS 20
+
+// Initial capacity of the depth first deques
+#define DEQUE_CAPACITY 1024
+
+/*
+ * Waits of a thread with no work: 2^k pauses on the k-th, up to
+ * 2^BACKOFF_MAX, then it yields its core to the threads that have some.
+ */
+#define BACKOFF_MAX 10
+
+/*
+ * Open nodes: the shallow ones in a multi-queue, best bound first, the
+ * deep ones in a deque per thread, depth first. A thread works on its own
+ * deque, then on the multi-queue, and steals from the others last.
+ */
+typedef struct
 {
-    Node next_node = *node;
+    /*
+     * mqueue:    nodes of depth lower than depth
+     * deques:    other nodes, or all if there are more than nodes of them
+     * nb_deques: one per thread
+     */
+    Mqueue mqueue;
+    Deque *restrict deques;
+    int nb_deques;
+    int depth;
+    long nodes;
 
     /*
-     * Early stop if we step into the initial node
-     * without doing a tour.
+     * Number of nodes pushed in the frontier and not fully branched yet.
+     * The search is over once it drops to zero.
      */
-    if (next_city == START && node->depth != n - 1)
+    long pending;
+
+    // Nodes dropped from the multi-queue by the better tours
+    long swept;
+} Frontier;
+
+/*
+ * Checkpoints of the search. A request parks the threads at the top of
+ * their loop, where they hold no node, so that the frontier is the whole
+ * search. The last one to park copies it, and the others wait for the
+ * copy only: a background thread writes it.
+ */
+typedef struct
+{
+    /*
+     * request:    CHECKPOINT_SAVE or CHECKPOINT_STOP, negated once the
+     *             copy started, 0 if none
+     * parked:     threads waiting for the copy
+     * finished:   threads out of the search, which hold no node either
+     * threads:    threads of the search
+     * generation: number of copies, which releases the parked threads
+     */
+    atomic_int request, parked, finished, threads;
+    atomic_long generation;
+
+    /*
+     * next:    time of the next periodic checkpoint
+     * stopped: whether a request stopped the search
+     * tour:    the best tour, being copied
+     */
+    double next;
+    bool stopped;
+    City *tour;
+    Checkpoint checkpoint;
+} Bbsave;
+
+// Allocators of a thread, where the payloads of the dropped nodes go
+typedef struct
+{
+    Pool *restrict pool, *restrict pi_pool;
+} Bbpools;
+
+// The penalties of a node, as Distances for the bounds
+static inline void
+bb_widen (Distance *restrict pi, const Penalties *restrict stored,
+          const size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        pi[i] = stored->pi[i];
+}
+
+// The penalties of an ascent, rounded for a node, see Penalty
+static inline void
+bb_narrow (Penalty *restrict stored, const Distance *restrict pi,
+           const size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        stored[i] = pi[i];
+}
+
+/*
+ * Pushing the children of a node, sorted by bound, at once: the first one
+ * is the best. They go in the same shard of the multi-queue, or on top of
+ * the deque with the best one popped first.
+ */
+static inline void
+bb_push (Frontier *restrict frontier, Deque *restrict deque,
+         const Node *restrict nodes, const size_t count,
+         unsigned *restrict seed)
+{
+    long pending;
+
+    //
+    if (!count)
         return;
 
-    // Allocating the reached array
-    {
-        const size_t size = n * sizeof (City);
-        next_node.reached = malloc (size);
-        if (!next_node.reached)
-            perror ("malloc"), exit (254);
-        memcpy (next_node.reached, node->reached, size);
-    }
+    // Accounted before being visible to the other threads
+#pragma omp atomic capture
+    pending = frontier->pending += count;
 
-    // Updating the node's state
-    next_node.depth++;
-    next_node.position = next_city;
-    next_node.tour += DIST (node->position, next_city);
+    //
+    if (nodes->depth < frontier->depth && pending < frontier->nodes)
+        mqueue_push_batch (&frontier->mqueue, nodes, count, seed);
+    else
+        for (size_t i = count; i--;)
+            deque_push (deque, nodes + i);
+}
 
-    // Update the degrees
-    next_node.reached[node->position]++;
-    next_node.reached[next_city]++;
+//
+static inline bool
+bb_pop (Frontier *restrict frontier, Deque *restrict deque,
+        Node *restrict node, unsigned *restrict seed, long *restrict steals)
+{
+    const int first = rand_r (seed) % frontier->nb_deques;
 
-#if 0
-    next_node.value
-        = next_node.tour + prim_bound_mst (pheap, distances, next_node.reached, n);
-#elif 1
-    next_node.value
-        = next_node.tour
-          + prim_bound_1tree_opt (pheap, distances, next_node.reached, n,
-                                  _tmp1, _tmp2);
-#else
-    if (next_node.depth < n / 2)
-        next_node.value
-            = next_node.tour
-              + prim_bound_1tree_opt (pheap, distances, next_node.reached, n,
-                                      _tmp1, _tmp2);
+    //
+    if (deque_pop (deque, node) || mqueue_pop (&frontier->mqueue, node, seed))
+        return true;
+
+    // Stealing the shallowest node of another thread
+    for (int i = 0; i < frontier->nb_deques; ++i)
+        {
+            Deque *victim
+                = frontier->deques + (first + i) % frontier->nb_deques;
+
+            if (victim != deque && deque_steal (victim, node))
+                {
+                    ++*steals;
+                    return true;
+                }
+        }
+
+    //
+    return false;
+}
+
+// Dropping a reference on penalties, and them once no node holds them
+static inline void
+bb_release (Pool *restrict pi_pool, Penalties *restrict pi)
+{
+    int refs;
+
+#pragma omp atomic capture
+    refs = --pi->refs;
+    if (!refs)
+        pool_put (pi_pool, pi);
+}
+
+//
+static void
+bb_drop (Node *restrict node, void *data)
+{
+    Bbpools *pools = data;
+
+    //
+    path_release (pools->pool, node->path);
+    bb_release (pools->pi_pool, node->pi);
+}
+
+//
+static void
+bb_save (const Node *restrict node, void *data)
+{
+    checkpoint_node (data, node);
+}
+
+// By one thread, a signal coming first, the periodic ones being delayed
+static inline void
+bb_poll (Bbsave *restrict save, const double interval)
+{
+    const int signal = checkpoint_signal ();
+    const double now = omp_get_wtime ();
+
+    //
+    if (signal & CHECKPOINT_STOP)
+        atomic_store (&save->request, CHECKPOINT_STOP);
+    else if (signal
+             || (now >= save->next && !checkpoint_busy (&save->checkpoint)))
+        atomic_store (&save->request, CHECKPOINT_SAVE);
     else
-        next_node.value
-            = next_node.tour
-              + prim_bound_mst (pheap, distances, next_node.reached, n);
+        return;
+    save->next = now + interval;
+}
+
+// Waiting once more, see BACKOFF_MAX; idle is the number of waits so far
+static inline void
+bb_backoff (int *restrict idle)
+{
+    if (*idle > BACKOFF_MAX)
+        {
+            sched_yield ();
+            return;
+        }
+    for (int i = 0; i < 1 << *idle; ++i)
+#if defined(__x86_64__)
+        _mm_pause ();
+#else
+        atomic_signal_fence (memory_order_seq_cst);
 #endif
+    (*idle)++;
+}
 
-    // Is it a solution ?
-    if (next_node.value < *best_tour)
+/*
+ * Waiting for the other threads, the last one to park copying the
+ * frontier in the order of the deques, the counters and the best tour.
+ */
+static void
+bb_park (Bbsave *restrict save, Frontier *restrict frontier,
+         Incumbent *restrict incumbent, const long *restrict iter,
+         const long *restrict leaves, const double start, bool *restrict stop)
+{
+    const long generation = atomic_load (&save->generation);
+    int request, idle = 0;
+
+    //
+    atomic_fetch_add (&save->parked, 1);
+    while (atomic_load (&save->generation) == generation)
         {
-            if (next_node.depth == n)
+            Cheader header;
+
+            // Only once every thread is parked or finished
+            request = atomic_load (&save->request);
+            if (request <= 0
+                || atomic_load (&save->parked) + atomic_load (&save->finished)
+                       < atomic_load (&save->threads)
+                || !atomic_compare_exchange_strong (&save->request, &request,
+                                                    -request))
                 {
-                    // free the previous solution
-#pragma omp critical
-                    *best_tour = next_node.tour;
-                    free (next_node.reached);
+                    bb_backoff (&idle);
+                    continue;
+                }
+
+            //
+            header.value = incumbent_tour (incumbent, save->tour);
+            header.elapsed = omp_get_wtime () - start;
+#pragma omp atomic read
+            header.iterations = *iter;
+#pragma omp atomic read
+            header.leaves = *leaves;
+#pragma omp atomic read
+            header.swept = frontier->swept;
+            header.improvements = atomic_load (&incumbent->improvements);
+            checkpoint_begin (&save->checkpoint, &header, save->tour);
+            mqueue_each (&frontier->mqueue, bb_save, &save->checkpoint);
+            for (int i = 0; i < frontier->nb_deques; ++i)
+                deque_each (frontier->deques + i, bb_save, &save->checkpoint);
+            checkpoint_end (&save->checkpoint);
+
+            //
+            if (request == CHECKPOINT_STOP)
+                {
+                    save->stopped = true;
+#pragma omp atomic write
+                    *stop = true;
+                }
+
+            // Released
+            atomic_store (&save->parked, 0);
+            atomic_store (&save->request, 0);
+            atomic_fetch_add (&save->generation, 1);
+        }
+}
+
+/*
+ * The frontier of a checkpoint, in place of the root. The steps of the
+ * paths are not shared anymore, each node getting its own. The shallow
+ * nodes go in the multi-queue, the deep ones in the deques, in turn, in
+ * the order they were saved in.
+ */
+static void
+bb_restore (Frontier *restrict frontier, Cresume *restrict resume,
+            Pool *restrict pool, Pool *restrict pi_pool, const size_t n)
+{
+    City *restrict cities = malloc (n * sizeof (City));
+    Crecord record;
+    Penalties *pi = pool_get (pi_pool);
+    unsigned seed = 1;
+    long count = 0;
+
+    //
+    if (!cities)
+        perror ("malloc"), exit (254);
+
+    //
+    for (; checkpoint_next (resume, &record, cities, pi->pi); ++count)
+        {
+            Node node = { .path = path_create (pool, cities[0]),
+                          .pi = pi,
+                          .value = record.value,
+                          .tour = record.tour,
+                          .position = record.position,
+                          .depth = record.depth };
+
+            // The node only holds its last step, and its own penalties
+            pi->refs = 1;
+            for (int i = 1; i <= node.depth; ++i)
+                {
+                    Step *step = path_extend (pool, node.path, cities[i]);
+
+                    path_release (pool, node.path);
+                    node.path = step;
                 }
+
+            //
+            if (node.depth < frontier->depth)
+                mqueue_push (&frontier->mqueue, &node, &seed);
             else
-#pragma omp critical
-                heap_push (heap, &next_node);
+                deque_push (frontier->deques + count % frontier->nb_deques,
+                            &node);
+            pi = pool_get (pi_pool);
         }
-    else
+    if ((uint64_t)count != resume->header.nodes)
+        fprintf (stderr, "checkpoint truncated or corrupted\n"), exit (255);
+
+    //
+    frontier->pending = count;
+    pool_put (pi_pool, pi);
+    free (cities);
+}
+
+/*
+ * Recording a tour shorter than the best one, without lock, which may
+ * eliminate edges. The nodes of the multi-queue that cannot beat it are
+ * then dropped at once, instead of one by one as they are popped. The
+ * deques are left to their owners, which pop them soon anyway.
+ */
+static inline void
+bb_improve (Frontier *restrict frontier, Incumbent *restrict incumbent,
+            Reduce *restrict reduce, Pool *restrict pool,
+            Pool *restrict pi_pool, const Distance length,
+            const City *restrict tour)
+{
+    Bbpools pools = { .pool = pool, .pi_pool = pi_pool };
+    long dropped;
+
+    //
+    if (!incumbent_improve (incumbent, length, tour))
+        return;
+    reduce_edges (reduce, length);
+    dropped = mqueue_prune (&frontier->mqueue, length, bb_drop, &pools);
+#pragma omp atomic
+    frontier->pending -= dropped;
+#pragma omp atomic
+    frontier->swept += dropped;
+}
+
+/*
+ * Branching the node on all its candidate cities at once. The children
+ * only differ by their new city, which stays open, so they share the first
+ * tree of their bound, built once from the tree of the node. Its weight
+ * gives the bound of every child before any ascent, and most of them are
+ * pruned there. The others go through the ascent, then are pushed together,
+ * sorted by bound. pi is the penalties of the node, widened, and ascent
+ * the ones of the ascent of a child. The children share the penalties of
+ * the best of them, which is expanded first, rather than each keeping its
+ * own: the ones of siblings only differ around their new city.
+ */
+static inline void
+bb_expand (Frontier *restrict frontier, Deque *restrict deque,
+           unsigned *restrict seed, Pool *restrict pool,
+           Pool *restrict pi_pool, Pwork *restrict pwork,
+           const Graph *restrict graph, Reduce *restrict reduce,
+           const Candidates *restrict edges, const Ptree *restrict ptree,
+           Incumbent *restrict incumbent, const Node *restrict node,
+           const Distance *restrict pi, Distance *restrict ascent,
+           const City *restrict degree, City *restrict reached,
+           City *restrict first, City *restrict tmp, Node *restrict children)
+{
+    const size_t n = graph->n;
+    const City position = node->position;
+    Distance best, weight, extra = 0, lowest = INFINITY;
+    Penalties *shared = NULL;
+    size_t count = 0;
+
+    // The degrees once the position is left, shared by the children
+    memcpy (reached, degree, n * sizeof (City));
+    reached[position]++;
+    weight = prim_first_tree (pwork, graph, edges, ptree,
+                              reached[position] == 2 ? position : -1, reached,
+                              pi, first);
+    for (City city = 0; city < n; ++city)
+        if (reached[city] != 2)
+            extra += (2 - reached[city]) * pi[city];
+
+    //
+    best = incumbent_value (incumbent);
+
+    //
+    for (size_t k = 0; k < candidates_count (edges, position); ++k)
         {
-            free (next_node.reached);
+            const City next = candidates_get (edges, position, k);
+            Node *restrict child = children + count;
+            const Distance tour = node->tour + DIST (position, next);
+
+            // Closing the tour, once every city is reached
+            if (next == START)
+                {
+                    if (node->depth == n - 1 && tour < best)
+                        {
+                            path_cities (node->path, tmp);
+                            bb_improve (frontier, incumbent, reduce, pool,
+                                        pi_pool, tour, tmp);
+                        }
+                    continue;
+                }
+            if (degree[next] == 2)
+                continue;
+
+            // The new city needs one edge less
+            if (tour + weight - extra + pi[next] >= best)
+                continue;
+
+            //
+            child->depth = node->depth + 1;
+            child->position = next;
+            child->tour = tour;
+            memcpy (ascent, pi, n * sizeof (Distance));
+            memcpy (tmp, first, n * sizeof (City));
+            reached[next]++;
+            tmp[next]++;
+            child->value = tour
+                           + prim_bound_ascent (pwork, graph, reached, ascent,
+                                                tmp, weight, best - tour,
+                                                NODE_ITERATIONS);
+            reached[next]--;
+
+            // Only the surviving nodes get a step, and the best penalties
+            if (child->value >= best)
+                continue;
+            if (!shared)
+                shared = pool_get (pi_pool);
+            if (child->value < lowest)
+                {
+                    bb_narrow (shared->pi, ascent, n);
+                    lowest = child->value;
+                }
+            child->path = path_extend (pool, node->path, next);
+            count++;
+        }
+
+    // Held by every child
+    if (shared)
+        shared->refs = count;
+    for (size_t i = 0; i < count; ++i)
+        children[i].pi = shared;
+
+    // Best bound first
+    for (size_t i = 1; i < count; ++i)
+        {
+            const Node child = children[i];
+            size_t j = i;
+
+            for (; j && children[j - 1].value > child.value; --j)
+                children[j] = children[j - 1];
+            children[j] = child;
         }
+
+    //
+    bb_push (frontier, deque, children, count, seed);
 }
 
-//
+/*
+ * Exact search of the shortest tour, given a known tour of length
+ * upper_bound (or INFINITY, tour being then ignored). Only the tours
+ * strictly shorter are explored. tour gets the best one, starting from
+ * the city 0, found through the paths of the nodes.
+ *
+ * The search runs on a view of the graph without the edges that cannot be
+ * in such a tour, given the bound of the root, which shares its matrix.
+ * The branching goes through the remaining edges only.
+ *
+ * With a checkpoint, the frontier is saved periodically and on SIGUSR1 or
+ * SIGTERM, which exits once it is written. A search resumed from it starts
+ * from its frontier, its best tour and its counters.
+ */
 Distance
-bb_solve (const Distance *restrict distances, const size_t n)
+bb_solve (const Graph *restrict original, City *restrict tour,
+          const Distance upper_bound, const Bbparams *restrict params)
 {
-    Distance best_tour = INFINITY;
-    Heap heap = heap_create (10000);
+    const size_t n = original->n, leaf = params->leaf;
+    const Graph *restrict graph = original;
+    Graph reduced;
+    Reduce reduce;
+    Candidates candidates, near;
+    size_t root_removed;
+    Incumbent incumbent;
+    Cresume resume = { 0 };
+    Bbsave save = { .next = omp_get_wtime () + params->interval };
+    Distance bound = upper_bound, best_tour;
+    Frontier frontier
+        = { .mqueue = mqueue_create (2 * omp_get_max_threads (), 10000),
+            .deques = aligned_alloc (64, omp_get_max_threads ()
+                                             * sizeof (Deque)),
+            .nb_deques = omp_get_max_threads (),
+            .depth = INT_MAX,
+            .nodes = LONG_MAX,
+            .pending = 1,
+            .swept = 0 };
     const long iter_max = 1e9;
-    long iter = 0;
-    int nb_worker = 0;
+    long iter = 0, leaves = 0, steals = 0;
+    double elapsed = omp_get_wtime ();
+    bool stop = false;
+
+    //
+    if (!frontier.deques)
+        perror ("aligned_alloc"), exit (254);
+    for (int i = 0; i < frontier.nb_deques; ++i)
+        frontier.deques[i] = deque_create (DEQUE_CAPACITY);
+
+    // A better tour of the checkpoint prunes from the root
+    if (params->resume)
+        {
+            resume = checkpoint_read (params->resume, original);
+            if (resume.header.value < bound)
+                {
+                    bound = resume.header.value;
+                    memcpy (tour, resume.tour, n * sizeof (City));
+                }
+            iter = resume.header.iterations;
+            leaves = resume.header.leaves;
+            frontier.swept = resume.header.swept;
+            elapsed -= resume.header.elapsed;
+        }
+    incumbent = incumbent_create (n, bound, bound < INFINITY ? tour : NULL);
+    if (params->resume)
+        atomic_store (&incumbent.improvements, resume.header.improvements);
+
+    //
+    if (params->checkpoint)
+        {
+            save.checkpoint = checkpoint_create (params->checkpoint, original);
+            save.tour = malloc (n * sizeof (City));
+            if (!save.tour)
+                perror ("malloc"), exit (254);
+            checkpoint_signals ();
+        }
+
+    // Where the depth first search starts
+    if (params->search == BB_DEPTH)
+        frontier.depth = 0;
+    else if (params->search == BB_HYBRID)
+        frontier.depth = params->depth, frontier.nodes = params->nodes;
+
+    /*
+     * One allocator per thread for the steps of the paths, and one for
+     * the penalties of the nodes. They are all released at the end of the
+     * search, with the nodes left in the frontier.
+     */
+    const int nb_pools = omp_get_max_threads ();
+    Pool *pools = aligned_alloc (64, nb_pools * sizeof (Pool));
+    Pool *pi_pools = aligned_alloc (64, nb_pools * sizeof (Pool));
+
+    if (!pools || !pi_pools)
+        perror ("aligned_alloc"), exit (254);
+    for (int i = 0; i < nb_pools; ++i)
+        {
+            pools[i] = pool_create (sizeof (Step));
+            pi_pools[i]
+                = pool_create (sizeof (Penalties) + n * sizeof (Penalty));
+        }
 
-    // First node
+    // First node, with a longer ascent from no penalty, which reduces
     {
-        const Node start = { .position = START,
-                             .tour = 0.0,
-                             .depth = 0,
-                             .value = INFINITY,
-                             .reached = calloc (n, sizeof (City)) };
+        Node start = { .position = START,
+                       .tour = 0.0,
+                       .depth = 0,
+                       .path = path_create (pools, START),
+                       .pi = pool_get (pi_pools) };
+        Pwork pwork = pwork_create (n);
+        City *restrict reached = calloc (n, sizeof (City));
+        City *restrict degree = malloc (n * sizeof (City));
+        City *restrict tree = malloc (n * sizeof (City));
+        Distance *restrict pi = calloc (n, sizeof (Distance));
+        unsigned seed = 1;
 
-        if (!start.reached)
-            perror ("calloc"), exit (254);
+        //
+        if (!reached || !degree || !tree || !pi)
+            perror ("malloc"), exit (254);
+        start.value = prim_bound_tree (&pwork, graph, reached, pi, degree,
+                                       tree, bound, ROOT_ITERATIONS);
+        start.pi->refs = 1;
+        bb_narrow (start.pi->pi, pi, n);
+        printf ("root bound: %.1f\n", start.value);
+
+        // Eliminating edges, the graph may then get sparse
+        reduce = reduce_create (graph, pi, tree, start.value);
+        root_removed = reduce_edges (&reduce, bound);
+        reduced = graph_reduce (graph, reduce.eliminated);
+
+        /*
+         * The lists of the remaining edges of a dense graph of coordinates
+         * would take O(n^2) memory, unlike its distances: its rows are
+         * walked in full instead. The near lists then only keep the
+         * alpha-nearest ones.
+         */
+        candidates = reduced.adjacent || !reduced.coords
+                         ? reduce_candidates (&reduce)
+                         : (Candidates){ .n = n };
+        near = candidates.list || !params->near
+                   ? candidates
+                   : candidates_alpha (&reduced, pi, tree, params->near);
+        if (candidates_near (&reduced, &near, params->near))
+            printf ("near: %zu edges\n", reduced.near_start[n]);
+        if (!candidates.list)
+            candidates_free (&near);
+        graph = &reduced;
 
-        heap_push (&heap, &start);
+        // Or the frontier of the checkpoint
+        if (params->resume)
+            {
+                bb_restore (&frontier, &resume, pools, pi_pools, n);
+                printf ("resumed: %ld nodes\n", frontier.pending);
+                path_release (pools, start.path);
+                bb_release (pi_pools, start.pi);
+                checkpoint_close (&resume);
+            }
+        else
+            mqueue_push (&frontier.mqueue, &start, &seed);
+        pwork_free (&pwork);
+        free (reached);
+        free (degree);
+        free (tree);
+        free (pi);
     }
 
 #pragma omp parallel
     {
-        Pheap _pheap = pheap_create (n);
-        City *restrict _reached = NULL;
-        Distance *restrict _distances = NULL;
-        bool stop = false;
+        Pool *restrict pool = pools + omp_get_thread_num ();
+        Pool *restrict pi_pool = pi_pools + omp_get_thread_num ();
+        Deque *restrict deque = frontier.deques + omp_get_thread_num ();
+        Pwork _pwork = pwork_create (n);
+        Ptree _ptree = ptree_create (n);
+        Dpwork _dpwork = dpwork_create (leaf);
+        City *restrict _reached = NULL, *restrict _degree = NULL,
+                       *restrict _first = NULL, *restrict _tmp = NULL,
+                       *restrict _tour = NULL;
+        Node *restrict _children = NULL;
+        Distance *restrict _pi = NULL, *restrict _ascent = NULL;
+        unsigned seed = 2 * omp_get_thread_num () + 1;
+        long _steals = 0;
+        int idle = 0;
+
+        //
+        atomic_store (&save.threads, omp_get_num_threads ());
 
         // Allocating temporary arrays
-        _distances = malloc (n * n * sizeof (Distance));
         _reached = malloc (n * sizeof (City));
-        if (!_distances || !_reached)
+        _degree = malloc (n * sizeof (City));
+        _first = malloc (n * sizeof (City));
+        _tmp = malloc (n * sizeof (City));
+        _tour = malloc (n * sizeof (City));
+        _children = malloc (n * sizeof (Node));
+        _pi = malloc (n * sizeof (Distance));
+        _ascent = malloc (n * sizeof (Distance));
+        if (!_reached || !_degree || !_first || !_tmp || !_tour
+            || !_children || !_pi || !_ascent)
             perror ("malloc"), exit (254);
 
         //
         while (true)
             {
                 Node current;
+                Distance best;
+                long left, count;
+                bool done;
 
-                // Getting the best node
-#pragma omp critical
-                {
-                    if (!stop && heap.size)
-                        {
-                            nb_worker++;
-                            current = heap_pop (&heap);
-                        }
-                    else
-                        stop = true;
-                }
+                // Another thread reached the max iteration
+#pragma omp atomic read
+                done = stop;
+                if (done)
+                    break;
 
-                //
-                if (stop)
+                // Holding no node, the frontier may be saved
+                if (params->checkpoint && !omp_get_thread_num ())
+                    bb_poll (&save, params->interval);
+                if (atomic_load (&save.request) > 0)
                     {
-                        if (nb_worker > 0)
-                            {
-                                stop = false;
-                                continue;
-                            }
-                        else
+                        bb_park (&save, &frontier, &incumbent, &iter, &leaves,
+                                 elapsed, &stop);
+                        continue;
+                    }
+
+                // Getting a good node, waiting for work if none is left
+                if (!bb_pop (&frontier, deque, &current, &seed, &_steals))
+                    {
+#pragma omp atomic read
+                        left = frontier.pending;
+                        if (!left)
                             break;
+                        bb_backoff (&idle);
+                        continue;
                     }
+                idle = 0;
 
-                // Check for terminaison
-                if (best_tour < current.value)
+                // Dropping the nodes that cannot improve the best tour
+                best = incumbent_value (&incumbent);
+                if (best <= current.value)
                     {
-#pragma omp critical
-                        nb_worker -= 1;
-                        free (current.reached);
-                        break;
+#pragma omp atomic
+                        frontier.pending -= 1;
+                        path_release (pool, current.path);
+                        bb_release (pi_pool, current.pi);
+                        continue;
                     }
 
 #if 0
@@ -178,44 +762,144 @@ bb_solve (const Distance *restrict distances, const size_t n)
                             "bound: "
                             "%5.1f best: %5.1f \n",
                             iter, current.depth, current.position,
-                            current.tour, current.value, best_tour);
+                            current.tour, current.value, best);
                 }
 #endif
 
                 // Branching on the node
-                for (size_t i = 0; i < n; ++i)
-                    if (current.reached[i] != 2 && current.position != i)
-                        bb_branch (&heap, &_pheap, distances, n, &best_tour,
-                                   &current, i, _distances, _reached);
+                path_degrees (current.path, _degree, n);
+                if (n - 1 - current.depth > leaf)
+                    {
+                        // Repaired for the bounds of the children
+                        bb_widen (_pi, current.pi, n);
+                        if (current.depth)
+                            prim_tree (&_pwork, graph, _degree, _pi, _reached,
+                                       &_ptree);
 
-                        // Finished the job
-#pragma omp critical
-                nb_worker -= 1;
+                        //
+                        bb_expand (&frontier, deque, &seed, pool, pi_pool,
+                                   &_pwork, graph, &reduce, &candidates,
+                                   current.depth ? &_ptree : NULL, &incumbent,
+                                   &current, _pi, _ascent, _degree, _reached,
+                                   _first, _tmp, _children);
+                    }
+
+                // Few cities left, solving the rest exactly
+                else
+                    {
+                        const Distance length
+                            = current.tour
+                              + dp_path (&_dpwork, graph, _degree,
+                                         current.position, TARGET);
+
+                        // The order of the tour, only when it is better
+                        if (length < incumbent_value (&incumbent))
+                            {
+                                dp_order (&_dpwork,
+                                          _tour
+                                              + path_cities (current.path,
+                                                             _tour));
+                                bb_improve (&frontier, &incumbent, &reduce,
+                                            pool, pi_pool, length, _tour);
+                            }
+#pragma omp atomic
+                        leaves += 1;
+                    }
 
                 // Free the node
-                free (current.reached);
+                path_release (pool, current.path);
+                bb_release (pi_pool, current.pi);
 
-#pragma omp critical
-                iter += 1;
-                if (iter == iter_max)
-                    break;
+                // Finished the job, after its children were accounted
+#pragma omp atomic
+                frontier.pending -= 1;
+
+#pragma omp atomic capture
+                count = ++iter;
+                if (count == iter_max)
+                    {
+#pragma omp atomic write
+                        stop = true;
+                    }
             }
+        atomic_fetch_add (&save.finished, 1);
 
         //
-        free (_distances);
         free (_reached);
-        pheap_free (&_pheap);
+        free (_degree);
+        free (_first);
+        free (_tmp);
+        free (_tour);
+        free (_children);
+        free (_pi);
+        free (_ascent);
+        pwork_free (&_pwork);
+        ptree_free (&_ptree);
+        dpwork_free (&_dpwork);
+#pragma omp atomic
+        steals += _steals;
     }
 
+    //
+    elapsed = omp_get_wtime () - elapsed;
+
     //
     if (iter == iter_max)
         fprintf (stderr, "/!\\ reached max iteration\n");
 
     //
     printf ("iterations: %ld\n", iter);
+    printf ("leaves: %ld\n", leaves);
+    printf ("steals: %ld\n", steals);
+    printf ("swept: %ld\n", frontier.swept);
+    printf ("improvements: %ld\n", atomic_load (&incumbent.improvements));
+    printf ("eliminated: %zu edges of %zu, %zu at the root\n", reduce.removed,
+            reduce.edges, root_removed);
+    printf ("nodes/s: %.0f (%d threads)\n", iter / elapsed,
+            omp_get_max_threads ());
+
+    // Allocation counters, summed over the threads
+    {
+        size_t gets = 0, slabs = 0;
+
+        for (int i = 0; i < nb_pools; ++i)
+            gets += pools[i].gets, slabs += pools[i].slabs;
+        printf ("allocations: %zu nodes, %zu system\n", gets, slabs);
+    }
+
+    // Once the last checkpoint is written
+    if (params->checkpoint)
+        {
+            checkpoint_free (&save.checkpoint);
+            free (save.tour);
+        }
+
+    // The nodes left in the frontier live in the pools
+    mqueue_free (&frontier.mqueue);
+    for (int i = 0; i < frontier.nb_deques; ++i)
+        deque_free (frontier.deques + i);
+    free (frontier.deques);
+    for (int i = 0; i < nb_pools; ++i)
+        {
+            pool_free (pools + i);
+            pool_free (pi_pools + i);
+        }
+    free (pools);
+    free (pi_pools);
+    candidates_free (&candidates);
+    graph_free (&reduced);
+    reduce_free (&reduce);
 
     //
-    heap_free (&heap);
+    best_tour = incumbent_value (&incumbent);
+    incumbent_tour (&incumbent, tour);
+    incumbent_free (&incumbent);
+
+    // The tour is not known to be the shortest, 128 + SIGTERM
+    if (save.stopped)
+        fprintf (stderr, "stopped, the search resumes from %s\n",
+                 params->checkpoint),
+            exit (143);
 
     //
     return best_tour;
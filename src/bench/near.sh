@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+#  PEDERSEN Ny Aina
+#  license: Unlicense
+#
+#  Checks the trees of the ascent on the near lists (see candidates_near)
+#  against the default ones: the tour of every file must be the same when
+#  they are forced, as they only steer the penalties.
+#  usage: bench/near.sh file...
+#
+
+TSP="${TSP:-./tsp}"
+
+[ $# -ge 1 ] || { echo "usage: $0 file..." >&2; exit 255; }
+
+status=0
+printf "%-32s %12s %12s %10s\n" file tour near edges
+for file in "$@"; do
+    expected=$("$TSP" "$file" | awk '/^tour:/ { print $2 }')
+    forced=$(TSP_NEAR=always "$TSP" "$file")
+    tour=$(echo "$forced" | awk '/^tour:/ { print $2 }')
+    edges=$(echo "$forced" | awk '/^near:/ { print $2 }')
+    printf "%-32s %12s %12s %10s\n" "$file" "$expected" "$tour" "${edges:--}"
+    if [ -z "$expected" ] || [ "$tour" != "$expected" ] || [ -z "$edges" ]
+    then
+        status=1
+    fi
+done
+exit $status
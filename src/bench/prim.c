@@ -0,0 +1,109 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Microbenchmark of the dense and heap based Prim kernels
+ * on random complete Euclidean graphs. TSP_RELAX selects
+ * the vector kernel of the dense one.
+ */
+
+#include "graph.h"
+#include "prim.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The matrix, see TILE
+static Weight *
+random_matrix (const size_t n)
+{
+    Weight *distances = graph_matrix (n);
+    double *x = malloc (n * sizeof (double));
+    double *y = malloc (n * sizeof (double));
+
+    //
+    if (!x || !y)
+        perror ("malloc"), exit (254);
+
+    //
+    for (size_t i = 0; i < n; ++i)
+        x[i] = rand () % 10000, y[i] = rand () % 10000;
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n && graph_stored (i, j); ++j)
+            distances[graph_index (n, i, j)]
+                = i == j ? WEIGHT_MISSING
+                         : sqrt ((x[i] - x[j]) * (x[i] - x[j])
+                                 + (y[i] - y[j]) * (y[i] - y[j]));
+
+    //
+    free (x);
+    free (y);
+
+    //
+    return distances;
+}
+
+// Mean time of one MST, in microseconds
+static double
+time_mst (Pwork *restrict pwork, const Graph *restrict graph,
+          const City *restrict reached, Distance *restrict weight)
+{
+    const size_t repeat = 1 + 20000000 / (graph->n * graph->n);
+    double elapsed = omp_get_wtime ();
+
+    //
+    for (size_t i = 0; i < repeat; ++i)
+        *weight = prim_bound_mst (pwork, graph, reached);
+
+    //
+    return (omp_get_wtime () - elapsed) / repeat * 1e6;
+}
+
+//
+int
+main (void)
+{
+    const size_t sizes[] = { 50, 100, 200, 500, 1000, 2000 };
+
+    //
+    printf ("dense kernel: %s\n", prim_relax_name (prim_relax_select ()));
+    printf ("%6s %12s %12s %8s\n", "n", "dense (us)", "heap (us)", "speedup");
+    for (size_t s = 0; s < sizeof (sizes) / sizeof (*sizes); ++s)
+        {
+            const size_t n = sizes[s];
+            Weight *distances = random_matrix (n);
+            City *reached = calloc (n, sizeof (City));
+            Graph dense = graph_create (distances, n);
+            Graph sparse = graph_create (distances, n);
+            Pwork pwork = pwork_create (n);
+            Distance w_dense, w_heap;
+            double t_dense, t_heap;
+
+            //
+            if (!reached)
+                perror ("calloc"), exit (254);
+
+            // Forcing the heap kernel
+            graph_adjacency (&sparse);
+
+            //
+            t_dense = time_mst (&pwork, &dense, reached, &w_dense);
+            t_heap = time_mst (&pwork, &sparse, reached, &w_heap);
+            printf ("%6zu %12.1f %12.1f %8.2f%s\n", n, t_dense, t_heap,
+                    t_heap / t_dense,
+                    fabs (w_dense - w_heap) > 1e-6 * w_dense ? " (mismatch)"
+                                                              : "");
+
+            //
+            pwork_free (&pwork);
+            graph_free (&dense);
+            graph_free (&sparse);
+            free (reached);
+            free (distances);
+        }
+
+    //
+    return 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,121 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Benchmark of the text reader against a plain fscanf one, on a random
+ * matrix of n cities (2000 by default) written in a temporary file.
+ * usage: bench/reader [n]
+ */
+
+#include "graph.h"
+#include "reader.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The reader before the parallel one, one fscanf per distance
+static Distance *
+fscanf_reader (const char *restrict file, size_t *n)
+{
+    Distance *distances;
+    FILE *f = fopen (file, "r");
+
+    //
+    if (!f)
+        perror ("fopen"), exit (255);
+    if (fscanf (f, " %zu", n) != 1)
+        fprintf (stderr, "%s: missing number of cities\n", file), exit (255);
+    distances = malloc (*n * *n * sizeof (Distance));
+    if (!distances)
+        perror ("malloc"), exit (254);
+    for (size_t i = 0; i < *n * *n; ++i)
+        if (fscanf (f, " %lf", distances + i) != 1)
+            fprintf (stderr, "%s: distance %zu missing\n", file, i),
+                exit (255);
+    for (size_t i = 0; i < *n; ++i)
+        distances[i * *n + i] = INFINITY;
+
+    //
+    fclose (f);
+    return distances;
+}
+
+//
+int
+main (int argc, char *argv[])
+{
+    const size_t n = argc > 1 ? strtoul (argv[1], NULL, 10) : 2000;
+    char file[] = "/tmp/tsp-reader-XXXXXX";
+    const int fd = mkstemp (file);
+    FILE *f = fd < 0 ? NULL : fdopen (fd, "w");
+    Distance *expected;
+    double *values = malloc (n * n * sizeof (double));
+    Matrix matrix;
+    double t_fscanf, t_reader, megabytes;
+    size_t m, mismatches = 0;
+
+    //
+    if (!f)
+        perror ("mkstemp"), exit (254);
+    if (!values)
+        perror ("malloc"), exit (254);
+
+    /*
+     * Integers and decimals, as found in the instances, unless int
+     * weights, symmetric as the reader checks
+     */
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j <= i; ++j)
+            values[i * n + j] = values[j * n + i]
+                = rand () % 2 || (Weight)0.5 == 0
+                      ? rand () % 100000
+                      : rand () % 10000000 / 1000.0;
+    fprintf (f, "%zu\n", n);
+    for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+                fprintf (f, values[i * n + j] == (int)values[i * n + j]
+                                ? "%.0f "
+                                : "%.3f ",
+                         values[i * n + j]);
+            fprintf (f, "\n");
+        }
+    free (values);
+    megabytes = ftell (f) / 1e6;
+    fclose (f);
+
+    //
+    t_fscanf = omp_get_wtime ();
+    expected = fscanf_reader (file, &m);
+    t_fscanf = omp_get_wtime () - t_fscanf;
+    t_reader = omp_get_wtime ();
+    matrix = reader (file, false);
+    t_reader = omp_get_wtime () - t_reader;
+
+    // Both must give the same weights, bit for bit, up to the diagonal
+    for (size_t a = 0; a < n; ++a)
+        for (size_t b = 0; b < n && graph_stored (a, b); ++b)
+            mismatches += a != b
+                          && (Weight)expected[a * n + b]
+                                 != matrix.distances[graph_index (n, a, b)];
+
+    //
+    printf ("%zu cities, %.1f MB, %d threads\n", n, megabytes,
+            omp_get_max_threads ());
+    printf ("%8s %10s %10s\n", "reader", "time (s)", "MB/s");
+    printf ("%8s %10.3f %10.1f\n", "fscanf", t_fscanf, megabytes / t_fscanf);
+    printf ("%8s %10.3f %10.1f\n", "parallel", t_reader,
+            megabytes / t_reader);
+    printf ("mismatches: %zu\n", mismatches);
+
+    //
+    unlink (file);
+    free (expected);
+    reader_free (&matrix);
+
+    //
+    return mismatches != 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
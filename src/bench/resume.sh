@@ -0,0 +1,30 @@
+#!/bin/sh
+#
+#  PEDERSEN Ny Aina
+#  license: Unlicense
+#
+#  Checks the checkpoints: a search stopped by SIGTERM after some seconds,
+#  saving every second, then resumed, must find the tour of a search run
+#  at once. The file must take longer than the delay (default 1) to solve.
+#  usage: bench/resume.sh file [seconds]
+#
+
+TSP="${TSP:-./tsp}"
+
+[ $# -ge 1 ] || { echo "usage: $0 file [seconds]" >&2; exit 255; }
+file="$1"
+delay="${2:-1}"
+checkpoint="$(mktemp)" || exit 254
+trap 'rm -f "$checkpoint" "$checkpoint.tmp"' EXIT
+
+expected=$("$TSP" "$file" | awk '/^tour:/ { print $2 }')
+timeout -s TERM "$delay" "$TSP" -C "$checkpoint" -i 1 "$file" > /dev/null
+if [ $? -ne 124 ]; then
+    echo "$file: solved within $delay seconds, nothing to resume" >&2
+    exit 1
+fi
+resumed=$("$TSP" -R "$checkpoint" "$file" | awk '/^tour:/ { print $2 }')
+
+printf "%-32s %12s %12s\n" file tour resumed
+printf "%-32s %12s %12s\n" "$file" "$expected" "$resumed"
+[ -n "$expected" ] && [ "$resumed" = "$expected" ]
@@ -0,0 +1,23 @@
+#!/bin/sh
+#
+#  PEDERSEN Ny Aina
+#  license: Unlicense
+#
+#  Thread scaling of the branch and bound, in expanded nodes per second.
+#  usage: bench/scaling.sh file [threads...]
+#
+
+TSP="${TSP:-./tsp}"
+
+[ $# -ge 1 ] || { echo "usage: $0 file [threads...]" >&2; exit 255; }
+file="$1"
+shift
+[ $# -ge 1 ] || set -- 1 2 4 8 16 32 64
+
+printf "%8s %12s %12s\n" threads iterations nodes/s
+for t in "$@"; do
+    OMP_PROC_BIND=spread OMP_NUM_THREADS="$t" "$TSP" "$file" | awk -v t="$t" '
+        /^iterations:/ { iter = $2 }
+        /^nodes\/s:/ { rate = $2 }
+        END { printf "%8d %12d %12d\n", t, iter, rate }'
+done
@@ -0,0 +1,420 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Candidate neighbour lists implementation
+ */
+
+#include "candidates.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIST(a, b) graph_distance (graph, a, b)
+#define MAX(a, b) (((a) < (b)) ? (b) : (a))
+
+// Cities relaxed at once by the dense Prim, see prim_relax.c
+#define LANES 8
+
+// Not relying on isinf, see graph.c
+#define EXISTS(d) ((d) < DBL_MAX)
+
+/*
+ * The k nearest neighbours of every city, through the finite edges,
+ * in O(n^2 k). Cities with fewer neighbours get shorter lists.
+ */
+Candidates
+candidates_nearest (const Graph *restrict graph, const size_t k)
+{
+    const size_t n = graph->n;
+    Candidates candidates = { .n = n };
+    size_t *restrict count = calloc (n, sizeof (size_t));
+
+    //
+    candidates.start = malloc ((n + 1) * sizeof (size_t));
+    candidates.list = malloc ((n * k + 1) * sizeof (City));
+    if (!count || !candidates.start || !candidates.list)
+        perror ("malloc"), exit (254);
+
+    // Insertion of every neighbour in a sorted list of size k
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t a = 0; a < n; ++a)
+        {
+            City *restrict list = candidates.list + a * k;
+
+            for (size_t b = 0; b < n; ++b)
+                {
+                    size_t i = count[a];
+
+                    //
+                    if (a == b || !EXISTS (DIST (a, b))
+                        || (i == k && DIST (a, list[k - 1]) <= DIST (a, b)))
+                        continue;
+
+                    // Shifting the farther ones
+                    if (i == k)
+                        i--;
+                    for (; i && DIST (a, b) < DIST (a, list[i - 1]); --i)
+                        list[i] = list[i - 1];
+                    list[i] = b;
+                    count[a] += count[a] < k;
+                }
+        }
+
+    // Packing the lists
+    candidates.start[0] = 0;
+    for (size_t a = 0; a < n; ++a)
+        {
+            const size_t start = candidates.start[a];
+
+            for (size_t i = 0; i < count[a]; ++i)
+                candidates.list[start + i] = candidates.list[a * k + i];
+            candidates.start[a + 1] = start + count[a];
+        }
+
+    //
+    free (count);
+
+    //
+    return candidates;
+}
+
+// Children of every city in the tree, in CSR format
+static void
+candidates_children (const City *restrict tree, const size_t n,
+                     size_t *restrict first, City *restrict children)
+{
+    size_t *restrict next = calloc (n, sizeof (size_t));
+
+    //
+    if (!next)
+        perror ("malloc"), exit (254);
+    memset (first, 0, (n + 1) * sizeof (size_t));
+    for (size_t a = 0; a < n; ++a)
+        if (tree[a] >= 0)
+            first[tree[a] + 1]++;
+    for (size_t a = 0; a < n; ++a)
+        first[a + 1] += first[a];
+    for (size_t a = 0; a < n; ++a)
+        if (tree[a] >= 0)
+            children[first[tree[a]] + next[tree[a]]++] = a;
+
+    //
+    free (next);
+}
+
+// Penalised cost of an edge
+#define COST(a, b) (DIST (a, b) + pi[a] + pi[b])
+
+/*
+ * Heaviest edge on the path from a to every city of the tree, in beta,
+ * walking the tree from a. stack and from are scratch arrays.
+ */
+static void
+candidates_beta (const Graph *restrict graph, const Distance *restrict pi,
+                 const City *restrict tree, const size_t *restrict first,
+                 const City *restrict children, const City a,
+                 Distance *restrict beta, City *restrict stack,
+                 City *restrict from)
+{
+    size_t top = 0;
+
+    //
+    beta[a] = -INFINITY;
+    from[a] = -1;
+    stack[top++] = a;
+    while (top)
+        {
+            const City b = stack[--top];
+
+#define VISIT(c)                                                              \
+    if ((c) != from[b])                                                       \
+        {                                                                     \
+            beta[c] = MAX (beta[b], COST (b, c));                             \
+            from[c] = b;                                                      \
+            stack[top++] = (c);                                               \
+        }
+            if (tree[b] >= 0)
+                VISIT (tree[b]);
+            for (size_t i = first[b]; i < first[b + 1]; ++i)
+                VISIT (children[i]);
+#undef VISIT
+        }
+}
+
+/*
+ * The k nearest neighbours in the alpha-nearness sense (Helsgaun): the
+ * increase of the weight of the tree if the edge (a, b) is forced in it,
+ * which is the penalised cost of the edge minus the heaviest edge on the
+ * path from a to b in the tree. The tree is given by the parent of every
+ * city, and built with the penalties pi. Ties go to the shortest edge.
+ * Runs in O(n^2 + n^2 k).
+ */
+Candidates
+candidates_alpha (const Graph *restrict graph, const Distance *restrict pi,
+                  const City *restrict tree, const size_t k)
+{
+    const size_t n = graph->n;
+    Candidates candidates = { .n = n };
+    size_t *restrict count = calloc (n, sizeof (size_t));
+    size_t *restrict first = malloc ((n + 1) * sizeof (size_t));
+    City *restrict children = malloc (n * sizeof (City));
+
+    //
+    candidates.start = malloc ((n + 1) * sizeof (size_t));
+    candidates.list = malloc ((n * k + 1) * sizeof (City));
+    if (!count || !first || !children || !candidates.start
+        || !candidates.list)
+        perror ("malloc"), exit (254);
+    candidates_children (tree, n, first, children);
+
+#pragma omp parallel
+    {
+        Distance *restrict beta = malloc (n * sizeof (Distance));
+        City *restrict stack = malloc (n * sizeof (City));
+        City *restrict from = malloc (n * sizeof (City));
+        Distance *restrict alpha = malloc (k * sizeof (Distance));
+
+        //
+        if (!beta || !stack || !from || !alpha)
+            perror ("malloc"), exit (254);
+
+#pragma omp for schedule(dynamic, 16)
+        for (size_t a = 0; a < n; ++a)
+            {
+                City *restrict list = candidates.list + a * k;
+
+                // Heaviest edge from a to every city, walking the tree
+                candidates_beta (graph, pi, tree, first, children, a, beta,
+                                 stack, from);
+
+                // Insertion in a sorted list of size k
+                for (size_t b = 0; b < n; ++b)
+                    {
+                        const Distance value = COST (a, b) - beta[b];
+                        size_t i = count[a];
+
+                        //
+                        if (a == b || !EXISTS (DIST (a, b))
+                            || (i == k
+                                && (alpha[k - 1] < value
+                                    || (alpha[k - 1] == value
+                                        && DIST (a, list[k - 1])
+                                               <= DIST (a, b)))))
+                            continue;
+
+                        // Shifting the worse ones
+                        if (i == k)
+                            i--;
+                        for (; i
+                               && (value < alpha[i - 1]
+                                   || (value == alpha[i - 1]
+                                       && DIST (a, b)
+                                              < DIST (a, list[i - 1])));
+                             --i)
+                            list[i] = list[i - 1], alpha[i] = alpha[i - 1];
+                        list[i] = b;
+                        alpha[i] = value;
+                        count[a] += count[a] < k;
+                    }
+            }
+
+        //
+        free (beta);
+        free (stack);
+        free (from);
+        free (alpha);
+    }
+
+    // Packing the lists
+    candidates.start[0] = 0;
+    for (size_t a = 0; a < n; ++a)
+        {
+            const size_t start = candidates.start[a];
+
+            for (size_t i = 0; i < count[a]; ++i)
+                candidates.list[start + i] = candidates.list[a * k + i];
+            candidates.start[a + 1] = start + count[a];
+        }
+
+    //
+    free (count);
+    free (first);
+    free (children);
+
+    //
+    return candidates;
+}
+
+/*
+ * The tree of the alpha-nearness, see candidates_alpha, whose penalties
+ * and parents are copied, so that the rows of alpha are computed again
+ * when needed instead of being stored: they are O(n^2).
+ */
+Calpha
+candidates_alpha_create (const size_t n, const Distance *restrict pi,
+                         const City *restrict tree)
+{
+    Calpha alpha = { .n = n };
+
+    //
+    alpha.pi = malloc (n * sizeof (Distance));
+    alpha.tree = malloc (n * sizeof (City));
+    alpha.first = malloc ((n + 1) * sizeof (size_t));
+    alpha.children = malloc (n * sizeof (City));
+    if (!alpha.pi || !alpha.tree || !alpha.first || !alpha.children)
+        perror ("malloc"), exit (254);
+    memcpy (alpha.pi, pi, n * sizeof (Distance));
+    memcpy (alpha.tree, tree, n * sizeof (City));
+    candidates_children (tree, n, alpha.first, alpha.children);
+
+    //
+    return alpha;
+}
+
+/*
+ * The alpha-nearness of the edges of a in row, INFINITY for the missing
+ * ones and for a itself, in O(n). stack and from are scratch arrays.
+ */
+void
+candidates_alpha_row (const Graph *restrict graph,
+                      const Calpha *restrict alpha, const City a,
+                      Distance *restrict row, City *restrict stack,
+                      City *restrict from)
+{
+    const Distance *restrict pi = alpha->pi;
+
+    //
+    candidates_beta (graph, pi, alpha->tree, alpha->first, alpha->children,
+                     a, row, stack, from);
+    for (size_t b = 0; b < alpha->n; ++b)
+        row[b] = (City)b != a && EXISTS (DIST (a, b)) ? COST (a, b) - row[b]
+                                                      : INFINITY;
+}
+
+//
+void
+candidates_alpha_free (Calpha *restrict alpha)
+{
+    free (alpha->pi);
+    free (alpha->tree);
+    free (alpha->first);
+    free (alpha->children);
+
+    // Safety
+    alpha->pi = NULL;
+    alpha->tree = NULL;
+    alpha->first = NULL;
+    alpha->children = NULL;
+}
+
+#undef COST
+
+// Whether b is among the k first candidates of a
+static inline bool
+candidates_within (const Candidates *restrict candidates, const City a,
+                   const City b, const size_t k)
+{
+    const size_t start = candidates->start[a],
+                 end = candidates->start[a + 1] < start + k
+                           ? candidates->start[a + 1]
+                           : start + k;
+
+    //
+    for (size_t i = start; i < end; ++i)
+        if (candidates->list[i] == b)
+            return true;
+    return false;
+}
+
+/*
+ * Sets the subgraph of the k first candidates of every city as the near
+ * lists of graph, an edge being kept if either end has it among its k
+ * first, so that the subgraph is undirected. It is only set, and true
+ * returned, when the heap Prim on it costs less than the Prim of graph, or
+ * always if the TSP_NEAR environment variable is "always", for tests.
+ */
+bool
+candidates_near (Graph *restrict graph, const Candidates *restrict candidates,
+                 const size_t k)
+{
+    const char *force = getenv ("TSP_NEAR");
+    const size_t n = graph->n;
+    size_t *restrict start, edges = 0, log_n = 1;
+    City *restrict near;
+
+    //
+    if (!k)
+        return false;
+
+    // Counting, an edge of both lists once
+    start = calloc (n + 1, sizeof (size_t));
+    if (!start)
+        perror ("malloc"), exit (254);
+    for (size_t a = 0; a < n; ++a)
+        for (size_t i = candidates->start[a];
+             i < candidates->start[a + 1] && i < candidates->start[a] + k;
+             ++i)
+            {
+                const City b = candidates->list[i];
+
+                start[a + 1]++;
+                if (!candidates_within (candidates, b, a, k))
+                    start[b + 1]++;
+            }
+    for (size_t a = 0; a < n; ++a)
+        start[a + 1] += start[a];
+    edges = start[n];
+
+    // Against the kernel of graph, the dense one relaxing LANES at once
+    while ((1ul << log_n) < n)
+        log_n++;
+    if ((!force || strcmp (force, "always"))
+        && (graph->adjacent ? edges >= graph->start[n]
+                            : edges * log_n * LANES >= n * n))
+        {
+            free (start);
+            return false;
+        }
+
+    // Filling, start[a] moving to the end of the list of a
+    near = malloc ((edges ? edges : 1) * sizeof (City));
+    if (!near)
+        perror ("malloc"), exit (254);
+    for (size_t a = 0; a < n; ++a)
+        for (size_t i = candidates->start[a];
+             i < candidates->start[a + 1] && i < candidates->start[a] + k;
+             ++i)
+            {
+                const City b = candidates->list[i];
+
+                near[start[a]++] = b;
+                if (!candidates_within (candidates, b, a, k))
+                    near[start[b]++] = a;
+            }
+
+    // Shifted by the filling
+    memmove (start + 1, start, n * sizeof (size_t));
+    start[0] = 0;
+
+    //
+    graph->near_start = start;
+    graph->near = near;
+    return true;
+}
+
+//
+void
+candidates_free (Candidates *restrict candidates)
+{
+    free (candidates->start);
+    free (candidates->list);
+
+    // Safety
+    candidates->start = NULL;
+    candidates->list = NULL;
+    candidates->n = 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
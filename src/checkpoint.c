@@ -0,0 +1,327 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Checkpoints of the branch and bound.
+ *
+ * The frontier, the best tour and the counters are enough to resume the
+ * search: the root is cheap to compute again, and so are the eliminated
+ * edges, from the best tour. A node only needs the cities of its path and
+ * its penalties, the steps of the paths being rebuilt when it is read.
+ */
+
+#include "checkpoint.h"
+#include "path.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Requests of the signals, set by the handler
+static atomic_int checkpoint_pending;
+
+// FNV-1a of size bytes, from hash
+static uint64_t
+checkpoint_fnv (uint64_t hash, const void *restrict data, const size_t size)
+{
+    const unsigned char *bytes = data;
+
+    //
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    return hash;
+}
+
+/*
+ * Over the bytes of the matrix (see graph_matrix), or of the coordinates
+ * and their type
+ */
+uint64_t
+checkpoint_hash (const Graph *restrict graph)
+{
+    const Coords *restrict coords = graph->coords;
+    uint64_t hash = 0xcbf29ce484222325;
+
+    //
+    if (!coords)
+        return checkpoint_fnv (hash, graph->distances,
+                               MATRIX_SIZE (graph->n) * sizeof (Weight));
+    hash = checkpoint_fnv (hash, &coords->type, sizeof (coords->type));
+    hash = checkpoint_fnv (hash, coords->x, coords->n * sizeof (double));
+    return checkpoint_fnv (hash, coords->y, coords->n * sizeof (double));
+}
+
+//
+Checkpoint
+checkpoint_create (const char *restrict file, const Graph *restrict graph)
+{
+    const size_t n = graph->n;
+    Checkpoint checkpoint
+        = { .file = file, .hash = checkpoint_hash (graph), .n = n };
+
+    //
+    checkpoint.temporary = malloc (strlen (file) + sizeof (".tmp"));
+    checkpoint.cities = malloc (n * sizeof (City));
+    if (!checkpoint.temporary || !checkpoint.cities)
+        perror ("malloc"), exit (254);
+    strcpy (checkpoint.temporary, file);
+    strcat (checkpoint.temporary, ".tmp");
+    atomic_init (&checkpoint.writing, false);
+
+    //
+    return checkpoint;
+}
+
+// A SIGTERM is not overridden by a later SIGUSR1
+static void
+checkpoint_handler (int signal)
+{
+    atomic_fetch_or (&checkpoint_pending,
+                     signal == SIGTERM ? CHECKPOINT_STOP : CHECKPOINT_SAVE);
+}
+
+//
+void
+checkpoint_signals (void)
+{
+    struct sigaction action = { .sa_handler = checkpoint_handler };
+
+    //
+    sigemptyset (&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction (SIGUSR1, &action, NULL)
+        || sigaction (SIGTERM, &action, NULL))
+        perror ("sigaction"), exit (254);
+}
+
+//
+int
+checkpoint_signal (void)
+{
+    return atomic_exchange (&checkpoint_pending, 0);
+}
+
+//
+bool
+checkpoint_busy (Checkpoint *restrict checkpoint)
+{
+    return atomic_load (&checkpoint->writing);
+}
+
+//
+static void
+checkpoint_append (Checkpoint *restrict checkpoint, const void *restrict data,
+                   const size_t size)
+{
+    //
+    if (checkpoint->size + size > checkpoint->capacity)
+        {
+            size_t capacity = checkpoint->capacity ? checkpoint->capacity : 1;
+
+            while (capacity < checkpoint->size + size)
+                capacity *= 2;
+            checkpoint->buffer = realloc (checkpoint->buffer, capacity);
+            if (!checkpoint->buffer)
+                perror ("realloc"), exit (254);
+            checkpoint->capacity = capacity;
+        }
+
+    //
+    memcpy (checkpoint->buffer + checkpoint->size, data, size);
+    checkpoint->size += size;
+}
+
+/*
+ * Waiting for the previous snapshot to be written, the buffer being then
+ * reused. The header is written last, once the nodes are counted.
+ */
+void
+checkpoint_begin (Checkpoint *restrict checkpoint,
+                  const Cheader *restrict header, const City *restrict tour)
+{
+    //
+    if (checkpoint->started)
+        pthread_join (checkpoint->thread, NULL);
+    checkpoint->started = false;
+
+    //
+    checkpoint->header = *header;
+    memcpy (checkpoint->header.magic, CHECKPOINT_MAGIC,
+            sizeof (checkpoint->header.magic));
+    checkpoint->header.n = checkpoint->n;
+    checkpoint->header.hash = checkpoint->hash;
+    checkpoint->header.nodes = 0;
+    checkpoint->size = sizeof (Cheader);
+    checkpoint_append (checkpoint, tour, checkpoint->n * sizeof (City));
+}
+
+//
+void
+checkpoint_node (Checkpoint *restrict checkpoint, const Node *restrict node)
+{
+    const Crecord record = { .value = node->value,
+                             .tour = node->tour,
+                             .position = node->position,
+                             .depth = node->depth };
+    const size_t count = path_cities (node->path, checkpoint->cities);
+
+    //
+    checkpoint_append (checkpoint, &record, sizeof (record));
+    checkpoint_append (checkpoint, checkpoint->cities, count * sizeof (City));
+    checkpoint_append (checkpoint, node->pi->pi,
+                       checkpoint->n * sizeof (Penalty));
+    checkpoint->header.nodes++;
+}
+
+/*
+ * A failure only loses this checkpoint, the search goes on. The previous
+ * one is still there.
+ */
+static void *
+checkpoint_write (void *data)
+{
+    Checkpoint *checkpoint = data;
+    FILE *f = fopen (checkpoint->temporary, "w");
+    bool written = f
+                   && fwrite (checkpoint->buffer, checkpoint->size, 1, f) == 1
+                   && !fflush (f) && !fsync (fileno (f));
+
+    //
+    if (f && fclose (f))
+        written = false;
+    if (!written || rename (checkpoint->temporary, checkpoint->file))
+        perror (checkpoint->file);
+
+    //
+    atomic_store (&checkpoint->writing, false);
+    return NULL;
+}
+
+//
+void
+checkpoint_end (Checkpoint *restrict checkpoint)
+{
+    memcpy (checkpoint->buffer, &checkpoint->header, sizeof (Cheader));
+    atomic_store (&checkpoint->writing, true);
+    if (pthread_create (&checkpoint->thread, NULL, checkpoint_write,
+                        checkpoint))
+        perror ("pthread_create"), exit (254);
+    checkpoint->started = true;
+}
+
+// Waiting for the last snapshot to be written
+void
+checkpoint_free (Checkpoint *restrict checkpoint)
+{
+    if (checkpoint->started)
+        pthread_join (checkpoint->thread, NULL);
+    free (checkpoint->buffer);
+    free (checkpoint->temporary);
+    free (checkpoint->cities);
+
+    // Safety
+    checkpoint->buffer = NULL;
+    checkpoint->temporary = NULL;
+    checkpoint->cities = NULL;
+    checkpoint->started = false;
+}
+
+// Read at once, for a search on the matrix distances only
+Cresume
+checkpoint_read (const char *restrict file, const Graph *restrict graph)
+{
+    const size_t n = graph->n;
+    Cresume resume = { 0 };
+    FILE *f = fopen (file, "r");
+    struct stat st;
+
+    //
+    if (!f)
+        perror ("fopen"), exit (255);
+    if (fstat (fileno (f), &st) < 0)
+        perror ("fstat"), exit (255);
+    if ((size_t)st.st_size < sizeof (Cheader) + n * sizeof (City)
+        || fread (&resume.header, sizeof (Cheader), 1, f) != 1
+        || memcmp (resume.header.magic, CHECKPOINT_MAGIC,
+                   sizeof (resume.header.magic)))
+        fprintf (stderr, "%s: not a checkpoint\n", file), exit (255);
+    if (resume.header.n != n
+        || resume.header.hash != checkpoint_hash (graph))
+        fprintf (stderr, "%s: checkpoint of another matrix\n", file),
+            exit (255);
+
+    //
+    resume.size = st.st_size - sizeof (Cheader) - n * sizeof (City);
+    resume.tour = malloc (n * sizeof (City));
+    resume.data = malloc (resume.size + 1);
+    if (!resume.tour || !resume.data)
+        perror ("malloc"), exit (254);
+    if (fread (resume.tour, sizeof (City), n, f) != n
+        || fread (resume.data, 1, resume.size, f) != resume.size)
+        perror ("fread"), exit (255);
+    fclose (f);
+
+    //
+    return resume;
+}
+
+/*
+ * The next node, and the depth + 1 cities of its path from the start up
+ * to its position. Returns false once every node is read.
+ */
+bool
+checkpoint_next (Cresume *restrict resume, Crecord *restrict record,
+                 City *restrict cities, Penalty *restrict pi)
+{
+    const size_t n = resume->header.n;
+    size_t count;
+
+    //
+    if (resume->offset == resume->size)
+        return false;
+    if (resume->size - resume->offset < sizeof (Crecord))
+        goto corrupted;
+    memcpy (record, resume->data + resume->offset, sizeof (Crecord));
+    resume->offset += sizeof (Crecord);
+
+    // The path, checked before it is indexed by city
+    if (record->depth < 0 || (size_t)record->depth >= n)
+        goto corrupted;
+    count = record->depth + 1;
+    if (resume->size - resume->offset
+        < count * sizeof (City) + n * sizeof (Penalty))
+        goto corrupted;
+    memcpy (cities, resume->data + resume->offset, count * sizeof (City));
+    resume->offset += count * sizeof (City);
+    for (size_t i = 0; i < count; ++i)
+        if (cities[i] < 0 || (size_t)cities[i] >= n)
+            goto corrupted;
+    if (cities[record->depth] != record->position)
+        goto corrupted;
+
+    //
+    memcpy (pi, resume->data + resume->offset, n * sizeof (Penalty));
+    resume->offset += n * sizeof (Penalty);
+    return true;
+
+corrupted:
+    fprintf (stderr, "checkpoint truncated or corrupted\n");
+    exit (255);
+}
+
+//
+void
+checkpoint_close (Cresume *restrict resume)
+{
+    free (resume->tour);
+    free (resume->data);
+
+    // Safety
+    resume->tour = NULL;
+    resume->data = NULL;
+    resume->size = resume->offset = 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
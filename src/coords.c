@@ -0,0 +1,136 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Distances computed from coordinates, with the rounding of TSPLIB
+ * (Reinelt, "TSPLIB 95"), so that the optimal tours match the published
+ * ones. A row is a loop over the coordinate arrays without branch, which
+ * vectorizes: the dense Prim computes the row of a city whenever it relaxes
+ * it, instead of reading it from a matrix of O(n^2) memory, which is only
+ * filled to convert a file.
+ */
+
+#include "coords.h"
+#include "graph.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+Coords
+coords_create (const size_t n, const Ctype type)
+{
+    Coords coords = { .type = type, .n = n };
+
+    //
+    coords.x = malloc (n * sizeof (double));
+    coords.y = malloc (n * sizeof (double));
+    if (!coords.x || !coords.y)
+        perror ("malloc"), exit (254);
+
+    //
+    return coords;
+}
+
+/*
+ * Converting the DDD.MM coordinates of GEO to radians, once for all,
+ * the degrees being truncated as in the reference codes.
+ */
+void
+coords_geo (Coords *restrict coords)
+{
+    for (size_t i = 0; i < coords->n; ++i)
+        {
+            const double lat = trunc (coords->x[i]),
+                         lon = trunc (coords->y[i]);
+
+            coords->x[i]
+                = COORDS_PI * (lat + 5.0 * (coords->x[i] - lat) / 3.0) / 180.0;
+            coords->y[i]
+                = COORDS_PI * (lon + 5.0 * (coords->y[i] - lon) / 3.0) / 180.0;
+        }
+}
+
+/*
+ * The distances from a to the cities before count in row, missing for a
+ * itself. The type is tested out of the loop, each loop being a vector
+ * kernel.
+ */
+void
+coords_row (const Coords *restrict coords, const City a, const size_t count,
+            Weight *restrict row)
+{
+    const double *restrict x = coords->x, *restrict y = coords->y;
+    const double xa = x[a], ya = y[a];
+
+    //
+    switch (coords->type)
+        {
+        case COORDS_EUC_2D:
+            for (size_t b = 0; b < count; ++b)
+                row[b] = coords_kernel (COORDS_EUC_2D, xa, ya, x[b], y[b]);
+            break;
+        case COORDS_CEIL_2D:
+            for (size_t b = 0; b < count; ++b)
+                row[b] = coords_kernel (COORDS_CEIL_2D, xa, ya, x[b], y[b]);
+            break;
+        case COORDS_ATT:
+            for (size_t b = 0; b < count; ++b)
+                row[b] = coords_kernel (COORDS_ATT, xa, ya, x[b], y[b]);
+            break;
+        case COORDS_GEO:
+            for (size_t b = 0; b < count; ++b)
+                row[b] = coords_kernel (COORDS_GEO, xa, ya, x[b], y[b]);
+            break;
+        }
+    if ((size_t)a < count)
+        row[a] = WEIGHT_MISSING;
+}
+
+// The matrix, the stored part of a row per iteration, see TILE
+Weight *
+coords_matrix (const Coords *restrict coords)
+{
+    const size_t n = coords->n;
+    Weight *distances = graph_matrix (n);
+
+#pragma omp parallel
+    {
+        Weight *row = malloc (n * sizeof (Weight));
+
+        //
+        if (!row)
+            perror ("malloc"), exit (254);
+
+#pragma omp for schedule(dynamic, 64)
+        for (size_t a = 0; a < n; ++a)
+            {
+                const size_t end = a / TILE * TILE + TILE,
+                             count = end < n && !graph_stored (a, end) ? end
+                                                                       : n;
+
+                coords_row (coords, a, count, row);
+                for (size_t b = 0; b < count; ++b)
+                    distances[graph_index (n, a, b)] = row[b];
+            }
+
+        //
+        free (row);
+    }
+
+    //
+    return distances;
+}
+
+//
+void
+coords_free (Coords *restrict coords)
+{
+    free (coords->x);
+    free (coords->y);
+
+    // Safety
+    coords->x = coords->y = NULL;
+    coords->n = 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
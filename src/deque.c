@@ -0,0 +1,196 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Work-stealing deque implementation, after Le, Pop, Cohen and
+ * Zappa Nardelli, "Correct and efficient work-stealing for weak memory
+ * models" (PPoPP 2013). The orderings need C11 atomics, which OpenMP
+ * pragmas do not give.
+ */
+
+#include "deque.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+static Darray *
+darray_create (const size_t size)
+{
+    Darray *array = malloc (sizeof (Darray) + size * sizeof (Node));
+
+    //
+    if (!array)
+        perror ("malloc"), exit (254);
+    array->size = size;
+
+    //
+    return array;
+}
+
+//
+Deque
+deque_create (const size_t capacity)
+{
+    Deque deque = { 0 };
+    size_t size = 1;
+
+    //
+    while (size < capacity)
+        size *= 2;
+    atomic_init (&deque.top, 0);
+    atomic_init (&deque.bottom, 0);
+    atomic_init (&deque.array, darray_create (size));
+
+    //
+    return deque;
+}
+
+/*
+ * Copying the nodes from top to bottom in a twice larger array.
+ * Only the owner grows the deque.
+ */
+static Darray *
+deque_grow (Deque *restrict deque, Darray *array, const long top,
+            const long bottom)
+{
+    Darray *larger = darray_create (2 * array->size);
+    Darray **retired = realloc (deque->retired, (deque->nb_retired + 1)
+                                                    * sizeof (Darray *));
+
+    //
+    if (!retired)
+        perror ("realloc"), exit (254);
+    for (long i = top; i < bottom; ++i)
+        larger->nodes[i & (larger->size - 1)]
+            = array->nodes[i & (array->size - 1)];
+
+    // The thieves may still read the old one
+    deque->retired = retired;
+    deque->retired[deque->nb_retired++] = array;
+    atomic_store_explicit (&deque->array, larger, memory_order_release);
+
+    //
+    return larger;
+}
+
+// Owner only
+void
+deque_push (Deque *restrict deque, const Node *restrict node)
+{
+    const long bottom
+        = atomic_load_explicit (&deque->bottom, memory_order_relaxed);
+    const long top = atomic_load_explicit (&deque->top, memory_order_acquire);
+    Darray *array = atomic_load_explicit (&deque->array, memory_order_relaxed);
+
+    //
+    if (bottom - top > (long)array->size - 1)
+        array = deque_grow (deque, array, top, bottom);
+    array->nodes[bottom & (array->size - 1)] = *node;
+
+    // The node is written before being visible
+    atomic_thread_fence (memory_order_release);
+    atomic_store_explicit (&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+// Owner only, last in first out
+bool
+deque_pop (Deque *restrict deque, Node *restrict node)
+{
+    const long bottom
+        = atomic_load_explicit (&deque->bottom, memory_order_relaxed) - 1;
+    Darray *array = atomic_load_explicit (&deque->array, memory_order_relaxed);
+    long top;
+    bool found = true;
+
+    //
+    atomic_store_explicit (&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence (memory_order_seq_cst);
+    top = atomic_load_explicit (&deque->top, memory_order_relaxed);
+
+    // Empty
+    if (bottom < top)
+        {
+            atomic_store_explicit (&deque->bottom, bottom + 1,
+                                   memory_order_relaxed);
+            return false;
+        }
+
+    //
+    *node = array->nodes[bottom & (array->size - 1)];
+
+    // The last node, racing against the thieves
+    if (bottom == top)
+        {
+            found = atomic_compare_exchange_strong_explicit (
+                &deque->top, &top, top + 1, memory_order_seq_cst,
+                memory_order_relaxed);
+            atomic_store_explicit (&deque->bottom, bottom + 1,
+                                   memory_order_relaxed);
+        }
+
+    //
+    return found;
+}
+
+// Any thread, first in first out
+bool
+deque_steal (Deque *restrict deque, Node *restrict node)
+{
+    long top = atomic_load_explicit (&deque->top, memory_order_acquire);
+    long bottom;
+
+    //
+    atomic_thread_fence (memory_order_seq_cst);
+    bottom = atomic_load_explicit (&deque->bottom, memory_order_acquire);
+
+    //
+    if (top < bottom)
+        {
+            const Darray *array
+                = atomic_load_explicit (&deque->array, memory_order_acquire);
+            const Node stolen = array->nodes[top & (array->size - 1)];
+
+            // Another thief or the owner was faster
+            if (!atomic_compare_exchange_strong_explicit (
+                    &deque->top, &top, top + 1, memory_order_seq_cst,
+                    memory_order_relaxed))
+                return false;
+
+            //
+            *node = stolen;
+            return true;
+        }
+
+    //
+    return false;
+}
+
+/*
+ * Visiting the nodes from top to bottom, pushing them back in this order
+ * rebuilds the deque. Neither the owner nor the thieves may run meanwhile.
+ */
+void
+deque_each (const Deque *restrict deque,
+            void (*visit) (const Node *restrict, void *), void *data)
+{
+    const Darray *array = atomic_load (&deque->array);
+    const long bottom = atomic_load (&deque->bottom);
+
+    //
+    for (long i = atomic_load (&deque->top); i < bottom; ++i)
+        visit (array->nodes + (i & (array->size - 1)), data);
+}
+
+// Freeing the arrays, the payloads of the nodes left belong to the caller
+void
+deque_free (Deque *restrict deque)
+{
+    free (atomic_load (&deque->array));
+    for (size_t i = 0; i < deque->nb_retired; ++i)
+        free (deque->retired[i]);
+    free (deque->retired);
+    deque->retired = NULL;
+    deque->nb_retired = 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,178 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Exact dynamic programming on small subproblems (Held-Karp), in
+ * O(2^k k^2) for k cities left.
+ *
+ * table[S][j] is the shortest path from the first city through the
+ * subset S of the cities left, ending at the j-th one. The k values of a
+ * subset are contiguous, so that a subset is computed from the rows of k
+ * smaller subsets, a cache line or two each, with a branch-free minimum
+ * over the whole row that the compiler vectorizes. The cities out of a
+ * subset are INFINITY in its row.
+ */
+
+#include "dp.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DIST(a, b) graph_distance (graph, a, b)
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+//
+Dpwork
+dpwork_create (const size_t size)
+{
+    Dpwork dpwork = { .size = size };
+
+    //
+    dpwork.table = malloc (((size_t)1 << size) * size * sizeof (Distance));
+    dpwork.link = malloc (size * size * sizeof (Distance));
+    dpwork.first = malloc (size * sizeof (Distance));
+    dpwork.last = malloc (size * sizeof (Distance));
+    dpwork.cities = malloc (size * sizeof (City));
+    if (size
+        && (!dpwork.table || !dpwork.link || !dpwork.first || !dpwork.last
+            || !dpwork.cities))
+        perror ("malloc"), exit (254);
+
+    //
+    return dpwork;
+}
+
+//
+void
+dpwork_free (Dpwork *restrict dpwork)
+{
+    free (dpwork->table);
+    free (dpwork->link);
+    free (dpwork->first);
+    free (dpwork->last);
+    free (dpwork->cities);
+}
+
+/*
+ * Shortest path from the city from to the city to, through all the
+ * cities of degree 0, at most dpwork->size of them. Returns INFINITY if
+ * there are more, or if there is no such path.
+ */
+Distance
+dp_path (Dpwork *restrict dpwork, const Graph *restrict graph,
+         const City *restrict degree, const City from, const City to)
+{
+    const size_t n = graph->n;
+    Distance *restrict table = dpwork->table, *restrict link = dpwork->link;
+    Distance *restrict first = dpwork->first, *restrict last = dpwork->last;
+    City *restrict cities = dpwork->cities;
+    Distance best = INFINITY;
+    size_t k = 0, full;
+
+    // Cities left
+    dpwork->k = 0;
+    for (size_t city = 0; city < n; ++city)
+        if (!degree[city] && city != from && city != to)
+            {
+                if (k == dpwork->size)
+                    return INFINITY;
+                cities[k++] = city;
+            }
+    dpwork->k = k;
+
+    //
+    if (!k)
+        return DIST (from, to);
+
+    // Compact distances
+    for (size_t l = 0; l < k; ++l)
+        {
+            first[l] = DIST (from, cities[l]);
+            last[l] = DIST (cities[l], to);
+            for (size_t j = 0; j < k; ++j)
+                link[l * k + j] = DIST (cities[j], cities[l]);
+        }
+
+    // Subsets by increasing value, every subset after its subsets
+    full = ((size_t)1 << k) - 1;
+    for (size_t subset = 1; subset <= full; ++subset)
+        {
+            Distance *restrict row = table + subset * k;
+
+            for (size_t l = 0; l < k; ++l)
+                {
+                    const size_t previous = subset ^ ((size_t)1 << l);
+                    const Distance *restrict prow = table + previous * k;
+                    const Distance *restrict lrow = link + l * k;
+                    Distance value = INFINITY;
+
+                    //
+                    if (!(subset >> l & 1))
+                        {
+                            row[l] = INFINITY;
+                            continue;
+                        }
+                    if (!previous)
+                        {
+                            row[l] = first[l];
+                            continue;
+                        }
+
+                    //
+                    for (size_t j = 0; j < k; ++j)
+                        value = MIN (value, prow[j] + lrow[j]);
+                    row[l] = value;
+                }
+        }
+
+    // Closing the path
+    for (size_t j = 0; j < k; ++j)
+        best = MIN (best, table[full * k + j] + last[j]);
+
+    //
+    return best;
+}
+
+/*
+ * Order of the cities left on the last path found by dp_path, which must
+ * be finite, in order. Walks back the table, the last city of a subset
+ * being the one that gives its value: O(k^2) instead of a link per entry.
+ */
+void
+dp_order (const Dpwork *restrict dpwork, City *restrict order)
+{
+    const Distance *restrict table = dpwork->table,
+                             *restrict link = dpwork->link;
+    const size_t k = dpwork->k;
+    size_t subset = ((size_t)1 << k) - 1, l = 0;
+
+    //
+    if (!k)
+        return;
+
+    // Last city of the path
+    for (size_t j = 1; j < k; ++j)
+        if (table[subset * k + j] + dpwork->last[j]
+            < table[subset * k + l] + dpwork->last[l])
+            l = j;
+
+    // Going back to the first one
+    for (size_t i = k; i--;)
+        {
+            const size_t previous = subset ^ ((size_t)1 << l);
+            size_t best = l;
+
+            //
+            order[i] = dpwork->cities[l];
+            for (size_t j = 0; j < k && previous; ++j)
+                if (previous >> j & 1
+                    && (best == l
+                        || table[previous * k + j] + link[l * k + j]
+                               < table[previous * k + best]
+                                     + link[l * k + best]))
+                    best = j;
+            subset = previous;
+            l = best;
+        }
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,196 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Graph implementation
+ */
+
+#include "graph.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DIST(a, b) graph_distance (graph, a, b)
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+/*
+ * Missing edges are INFINITY. Not using isinf, which may be folded
+ * away by -ffinite-math-only.
+ */
+#define EXISTS(d) ((d) < DBL_MAX)
+
+/*
+ * The matrix of n cities, zeroed: the distances past n are
+ * neither read nor set, but are hashed and written with the others.
+ */
+Weight *
+graph_matrix (const size_t n)
+{
+    Weight *distances = calloc (MATRIX_SIZE (n) + 1, sizeof (Weight));
+
+    //
+    if (!distances)
+        perror ("malloc"), exit (254);
+    return distances;
+}
+
+/*
+ * Adjacency lists are only built if the graph is sparse enough for a heap
+ * based Prim, in O(m log n), to beat the dense one, in O(n^2).
+ */
+static void
+graph_sparse (Graph *restrict graph)
+{
+    const size_t n = graph->n;
+    size_t edges = 0, log_n = 1;
+
+    // Both directions
+    for (size_t a = 0; a < n; ++a)
+        for (size_t b = 0; b < a; ++b)
+            edges += 2 * EXISTS (DIST (a, b));
+
+    //
+    while ((1ul << log_n) < n)
+        log_n++;
+
+    //
+    if (edges * log_n < n * n / 2)
+        graph_adjacency (graph);
+}
+
+// Building the graph of a distance matrix, see TILE
+Graph
+graph_create (const Weight *restrict distances, const size_t n)
+{
+    Graph graph = { .distances = distances, .n = n };
+
+    //
+    graph_sparse (&graph);
+    return graph;
+}
+
+/*
+ * Building the graph of cities given by their coordinates, which is
+ * complete: it is dense, and its distances are never stored.
+ */
+Graph
+graph_coords (const Coords *restrict coords)
+{
+    return (Graph){ .coords = coords, .n = coords->n };
+}
+
+/*
+ * The graph without the edges of removed, a bitset which may grow while
+ * the graph is used: the matrix is shared, and the adjacency lists are
+ * only built from the edges left now.
+ */
+Graph
+graph_reduce (const Graph *restrict graph, const uint64_t *removed)
+{
+    Graph reduced = { .distances = graph->distances,
+                      .coords = graph->coords,
+                      .removed = removed,
+                      .n = graph->n };
+
+    //
+    graph_sparse (&reduced);
+    return reduced;
+}
+
+/*
+ * The distances from a to every city in row, WEIGHT_MISSING for a itself
+ * and for the removed edges. The row is copied from the matrix, by TILE
+ * distances, a column of a tile above the diagonal of a triangle, see
+ * TILE, or computed from the coordinates. The removed edges are then
+ * masked, a byte or a column of a word of bits for TILE distances.
+ */
+void
+graph_row (const Graph *restrict graph, const City a, Weight *restrict row)
+{
+    const Weight *restrict distances = graph->distances;
+    const size_t n = graph->n, own = a / TILE;
+    const size_t full = n / TILE;
+
+    //
+    if (graph->coords)
+        coords_row (graph->coords, a, n, row);
+    else
+        for (size_t tile = 0; tile < TILES (n); ++tile)
+            {
+                const size_t stride = graph_column (own, tile) ? TILE : 1;
+                const Weight *restrict weights
+                    = distances + graph_index (n, a, tile * TILE);
+
+                // Full tiles, whose loops are unrolled
+                if (tile < full)
+                    for (size_t c = 0; c < TILE; ++c)
+                        row[tile * TILE + c] = weights[c * stride];
+                else
+                    for (size_t c = 0; tile * TILE + c < n; ++c)
+                        row[tile * TILE + c] = weights[c * stride];
+            }
+
+    // Removed edges
+    for (size_t tile = 0; tile < TILES (n); ++tile)
+        {
+            const size_t stride = graph_column (own, tile) ? TILE : 1;
+            const size_t i = graph_index (n, a, tile * TILE);
+            const uint64_t word = graph_removed (graph->removed, i);
+
+            if (word)
+                for (size_t c = 0; c < MIN (TILE, n - tile * TILE); ++c)
+                    if (word >> (i % (TILE * TILE) + c * stride) & 1)
+                        row[tile * TILE + c] = WEIGHT_MISSING;
+        }
+    row[a] = WEIGHT_MISSING;
+}
+
+// Building the adjacency lists of the finite edges
+void
+graph_adjacency (Graph *restrict graph)
+{
+    const size_t n = graph->n;
+    size_t edges = 0;
+
+    //
+    graph->start = malloc ((n + 1) * sizeof (size_t));
+    if (!graph->start)
+        perror ("malloc"), exit (254);
+
+    // Counting
+    for (size_t a = 0; a < n; ++a)
+        {
+            graph->start[a] = edges;
+            for (size_t b = 0; b < n; ++b)
+                edges += a != b && EXISTS (DIST (a, b));
+        }
+    graph->start[n] = edges;
+
+    // Filling
+    graph->adjacent = malloc ((edges ? edges : 1) * sizeof (City));
+    if (!graph->adjacent)
+        perror ("malloc"), exit (254);
+    for (size_t a = 0, k = 0; a < n; ++a)
+        for (size_t b = 0; b < n; ++b)
+            if (a != b && EXISTS (DIST (a, b)))
+                graph->adjacent[k++] = b;
+}
+
+//
+void
+graph_free (Graph *restrict graph)
+{
+    free (graph->start);
+    free (graph->adjacent);
+    free (graph->near_start);
+    free (graph->near);
+
+    // Safety, the distances, coords and removed belong to the caller
+    graph->start = NULL;
+    graph->adjacent = NULL;
+    graph->near_start = NULL;
+    graph->near = NULL;
+    graph->n = 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
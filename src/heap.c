@@ -2,7 +2,12 @@
  * PEDERSEN Ny Aina
  * license: Unlicense
  *
- * Binary heap implementation
+ * 4-ary heap implementation.
+ *
+ * The heap only moves small keys, the bound of a node and the slot of its
+ * payload: four children fit in a cache line, and a sift never copies a
+ * whole node. The payloads stay in their slots until they are popped,
+ * the freed slots being reused by the next pushes.
  */
 
 #include "heap.h"
@@ -22,10 +27,13 @@ heap_create (const size_t capacity)
     //
     heap.capacity = capacity;
     heap.size = 0;
+    heap.nb_free = 0;
 
     //
-    heap.heap = calloc (capacity, sizeof (Node));
-    if (!heap.heap)
+    heap.keys = calloc (capacity, sizeof (Hkey));
+    heap.nodes = calloc (capacity, sizeof (Node));
+    heap.free = calloc (capacity, sizeof (size_t));
+    if (!heap.keys || !heap.nodes || !heap.free)
         perror ("calloc"), exit (254);
 
     //
@@ -34,95 +42,166 @@ heap_create (const size_t capacity)
 
 // Helpful macros
 #define ROOT 0
-#define PARENT(i) ((i - 1) / 2)
-#define LEFT_CHILD(i) (2 * i + 1)
-#define RIGHT_CHILD(i) (2 * i + 2)
-#define EXISTS(i, heap) (i < heap->size)
-#define SWAP(a, b)                                                            \
-    {                                                                         \
-        Node tmp = a;                                                         \
-        a = b;                                                                \
-        b = tmp;                                                              \
-    }
+#define ARITY 4
+#define PARENT(i) (((i) - 1) / ARITY)
+#define FIRST_CHILD(i) (ARITY * (i) + 1)
+
+/*
+ * Moving the key at current up, until its parent is not greater.
+ * O(log4 n) in the worst case, when it ends at the root.
+ */
+static inline void
+heap_up (Heap *restrict heap, size_t current)
+{
+    const Hkey key = heap->keys[current];
+
+    //
+    for (; current != ROOT; current = PARENT (current))
+        {
+            if (key.value >= heap->keys[PARENT (current)].value)
+                break;
+            heap->keys[current] = heap->keys[PARENT (current)];
+        }
+    heap->keys[current] = key;
+}
+
+/*
+ * Moving the key at current down, until its children are not lower.
+ * Every level reads the keys of four children, on one cache line.
+ */
+static inline void
+heap_down (Heap *restrict heap, size_t current)
+{
+    const Hkey key = heap->keys[current];
+
+    //
+    while (FIRST_CHILD (current) < heap->size)
+        {
+            const size_t first = FIRST_CHILD (current);
+            const size_t last = first + ARITY < heap->size ? first + ARITY
+                                                           : heap->size;
+            size_t next = first;
+
+            // Getting the child with the lowest value
+            for (size_t child = first + 1; child < last; ++child)
+                if (heap->keys[child].value < heap->keys[next].value)
+                    next = child;
+
+            //
+            if (key.value <= heap->keys[next].value)
+                break;
+            heap->keys[current] = heap->keys[next];
+            current = next;
+        }
+    heap->keys[current] = key;
+}
 
 //
 void
 heap_push (Heap *restrict heap, const Node *restrict node)
 {
+    size_t slot;
+
     // Dynamic expansion if full
     if (heap->size == heap->capacity)
         {
             heap->capacity *= 2;
-            heap->heap
-                = reallocarray (heap->heap, heap->capacity, sizeof (Node));
-            if (!heap->heap)
+            heap->keys
+                = reallocarray (heap->keys, heap->capacity, sizeof (Hkey));
+            heap->nodes
+                = reallocarray (heap->nodes, heap->capacity, sizeof (Node));
+            heap->free
+                = reallocarray (heap->free, heap->capacity, sizeof (size_t));
+            if (!heap->keys || !heap->nodes || !heap->free)
                 fprintf (stderr, "failed to realloc the heap\n"), exit (253);
         }
 
-    // Add the node to the last place
-    heap->heap[heap->size] = *node;
-    heap->size++;
-
-    /*
-     * Restoring the max heap property (bottom up).
-     * In the worst case, we will finish on the root node.
-     * So the worst complexity is O(log n), since it is a
-     * complete binary tree.
-     */
-    for (size_t current = heap->size - 1; current != ROOT;
-         current = PARENT (current))
-        {
-            // Comparing current and its parent
-            if (heap->heap[current].value
-                >= heap->heap[PARENT (current)].value)
-                break;
+    // A freed slot, or the first one never used
+    slot = heap->nb_free ? heap->free[--heap->nb_free] : heap->size;
+    heap->nodes[slot] = *node;
 
-            // Not OK, swapping them
-            SWAP (heap->heap[current], heap->heap[PARENT (current)]);
-        }
+    // Add the key to the last place, then restoring the min heap property
+    heap->keys[heap->size].value = node->value;
+    heap->keys[heap->size].slot = slot;
+    heap_up (heap, heap->size++);
 }
 
 //
 Node
 heap_pop (Heap *restrict heap)
 {
-    Node node;
+    size_t slot;
 
     //
     if (heap_empty (heap))
         fprintf (stderr, "popping an empty heap\n"), exit (252);
 
-    // Getting the max
-    node = heap->heap[ROOT];
+    // Getting the min, its slot is free again
+    slot = heap->keys[ROOT].slot;
+    heap->free[heap->nb_free++] = slot;
 
-    /*
-     * Moving the last node to the root and doing a top-down
-     * to update the tree.
-     * Still in O(log n) in the worst case since we might go
-     * straight to a leaf of the binary heap.
-     */
+    // Moving the last key to the root, top-down
     heap->size--;
-    heap->heap[ROOT] = heap->heap[heap->size];
-    for (size_t current = ROOT, next = current; current < heap->size;
-         current = next)
+    if (heap->size)
         {
-            // Getting the child with the greatest value
-            if (EXISTS (LEFT_CHILD (current), heap))
-                next = LEFT_CHILD (current);
-            if (EXISTS (RIGHT_CHILD (current), heap)
-                && heap->heap[next].value
-                       > heap->heap[RIGHT_CHILD (current)].value)
-                next = RIGHT_CHILD (current);
-
-            // Testing the current node against its child
-            if (heap->heap[current].value > heap->heap[next].value)
-                SWAP (heap->heap[current], heap->heap[next])
+            heap->keys[ROOT] = heap->keys[heap->size];
+            heap_down (heap, ROOT);
+        }
+
+    //
+    return heap->nodes[slot];
+}
+
+//
+inline Distance
+heap_top (const Heap *restrict heap)
+{
+    return heap->keys[ROOT].value;
+}
+
+/*
+ * Dropping every node whose bound reaches bound, drop being called on its
+ * payload. The kept keys are packed, then the heap is rebuilt bottom-up,
+ * in O(n). Returns the number of dropped nodes.
+ */
+size_t
+heap_prune (Heap *restrict heap, const Distance bound,
+            void (*drop) (Node *restrict, void *), void *data)
+{
+    const size_t size = heap->size;
+
+    //
+    heap->size = 0;
+    for (size_t i = 0; i < size; ++i)
+        {
+            const Hkey key = heap->keys[i];
+
+            //
+            if (key.value < bound)
+                heap->keys[heap->size++] = key;
             else
-                break;
+                {
+                    drop (heap->nodes + key.slot, data);
+                    heap->free[heap->nb_free++] = key.slot;
+                }
         }
 
+    // From the parent of the last key up to the root
+    if (heap->size > 1)
+        for (size_t i = PARENT (heap->size - 1) + 1; i--;)
+            heap_down (heap, i);
+
     //
-    return node;
+    return size - heap->size;
+}
+
+// In the order of the keys, which is not the order of the values
+void
+heap_each (const Heap *restrict heap,
+           void (*visit) (const Node *restrict, void *), void *data)
+{
+    for (size_t i = 0; i < heap->size; ++i)
+        visit (heap->nodes + heap->keys[i].slot, data);
 }
 
 //
@@ -138,7 +217,7 @@ heap_print (const Heap *restrict heap)
 {
     printf ("%ld: ", heap->size);
     for (size_t i = 0; i < heap->size; ++i)
-        printf ("%lf ", heap->heap[i].value);
+        printf ("%lf ", heap->keys[i].value);
     printf ("\n");
 }
 
@@ -146,13 +225,11 @@ heap_print (const Heap *restrict heap)
 void
 heap_free (Heap *restrict heap)
 {
-    // Freeing the items of the container
-    for (size_t i = 0; i < heap->size; ++i)
-        free (heap->heap[i].reached);
-
-    // Free the container
-    free (heap->heap);
+    // Free the containers, the paths of the nodes belong to the caller
+    free (heap->keys);
+    free (heap->nodes);
+    free (heap->free);
 
     // Safety
-    heap->capacity = heap->size = 0;
+    heap->capacity = heap->size = heap->nb_free = 0;
 }
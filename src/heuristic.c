@@ -0,0 +1,364 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Heuristic tours implementation.
+ *
+ * A nearest neighbour tour is built from several start cities, in
+ * parallel, then improved by 2-opt and Or-opt moves until a local
+ * optimum is reached. Both moves only look at the nearest neighbours
+ * of a city, and their gains assume a symmetric matrix. The best tour
+ * gives an upper bound to the branch and bound.
+ */
+
+#include "heuristic.h"
+#include "tour.h"
+#include <assert.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIST(a, b) graph_distance (graph, a, b)
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) < (b)) ? (b) : (a))
+
+// Position of the successor and the predecessor in the tour
+#define NEXT(i) (((i) + 1) % n)
+#define PREV(i) (((i) + n - 1) % n)
+
+// Size of the neighbour lists, and of the moved segments
+#define NB_CANDIDATES 10
+#define MAX_SEGMENT 3
+
+// Minimum number of start cities
+#define MIN_STARTS 8
+
+// Minimal gain of a move, against rounding loops
+#define EPSILON 1e-9
+
+/*
+ * Maximum number of passes of the local search, far more than it takes
+ * (26 on 1000 random cities), against a loop of moves which it would not
+ * leave
+ */
+#define MAX_PASSES 1000
+
+//
+static void
+heuristic_nearest (const Graph *restrict graph, const City start,
+                   City *restrict tour, bool *restrict visited)
+{
+    const size_t n = graph->n;
+
+    //
+    memset (visited, 0, n * sizeof (bool));
+    tour[0] = start;
+    visited[start] = true;
+
+    //
+    for (size_t i = 1; i < n; ++i)
+        {
+            const City last = tour[i - 1];
+            City next = -1;
+
+            //
+            for (size_t city = 0; city < n; ++city)
+                if (!visited[city]
+                    && (next < 0 || DIST (last, city) < DIST (last, next)))
+                    next = city;
+
+            //
+            tour[i] = next;
+            visited[next] = true;
+        }
+}
+
+/*
+ * Reversing the positions i to j of the tour, going forward.
+ * Reversing the rest of the tour gives the same cycle, so the
+ * shortest of both is reversed.
+ */
+static inline void
+heuristic_reverse (City *restrict tour, City *restrict pos, const size_t n,
+                   size_t i, size_t j)
+{
+    size_t length = (j + n - i) % n + 1;
+
+    //
+    if (2 * length > n)
+        {
+            const size_t start = NEXT (j);
+
+            j = PREV (i);
+            i = start;
+            length = n - length;
+        }
+
+    //
+    for (size_t k = 0; k < length / 2; ++k)
+        {
+            const size_t a = (i + k) % n, b = (j + n - k) % n;
+            const City tmp = tour[a];
+
+            tour[a] = tour[b];
+            tour[b] = tmp;
+            pos[tour[a]] = a;
+            pos[tour[b]] = b;
+        }
+}
+
+/*
+ * 2-opt pass: removing two edges of the tour and reconnecting
+ * it the other way, if an end gets closer to one of its candidates.
+ */
+static bool
+heuristic_2opt (const Graph *restrict graph,
+                const Candidates *restrict candidates, City *restrict tour,
+                City *restrict pos)
+{
+    const size_t n = graph->n;
+    bool improved = false;
+
+    //
+    for (size_t i = 0; i < n; ++i)
+        for (size_t k = candidates->start[tour[i]];
+             k < candidates->start[tour[i] + 1]; ++k)
+            {
+                const City a = tour[i], next = tour[NEXT (i)],
+                           prev = tour[PREV (i)], c = candidates->list[k];
+                const size_t j = pos[c];
+                const Distance gain = DIST (a, c);
+
+                // Farther than both neighbours, no more move
+                if (gain >= DIST (a, next) && gain >= DIST (a, prev))
+                    break;
+
+                // (a, next) and (c, c_next) become (a, c) and (next, c_next)
+                if (c != next && tour[NEXT (j)] != a
+                    && gain + DIST (next, tour[NEXT (j)]) + EPSILON
+                           < DIST (a, next) + DIST (c, tour[NEXT (j)]))
+                    {
+                        heuristic_reverse (tour, pos, n, NEXT (i), j);
+                        improved = true;
+                        break;
+                    }
+
+                // (prev, a) and (c_prev, c) become (prev, c_prev) and (a, c)
+                if (c != prev && tour[PREV (j)] != a
+                    && gain + DIST (prev, tour[PREV (j)]) + EPSILON
+                           < DIST (prev, a) + DIST (tour[PREV (j)], c))
+                    {
+                        heuristic_reverse (tour, pos, n, i, PREV (j));
+                        improved = true;
+                        break;
+                    }
+            }
+
+    //
+    return improved;
+}
+
+/*
+ * Moving the segment of length cities starting at position i after the
+ * city after, possibly reversed.
+ */
+static void
+heuristic_move (City *restrict tour, City *restrict pos, City *restrict tmp,
+                const size_t n, const size_t i, const size_t length,
+                const City after, const bool reversed)
+{
+    size_t m = 0;
+
+    // The cities out of the segment, starting after it
+    for (size_t k = length; k < n; ++k)
+        {
+            const City city = tour[(i + k) % n];
+
+            tmp[m++] = city;
+            if (city == after)
+                for (size_t l = 0; l < length; ++l)
+                    tmp[m++] = tour[(i + (reversed ? length - 1 - l : l)) % n];
+        }
+
+    //
+    memcpy (tour, tmp, n * sizeof (City));
+    for (size_t k = 0; k < n; ++k)
+        pos[tour[k]] = k;
+}
+
+/*
+ * Or-opt pass: moving a segment of 1 to MAX_SEGMENT cities between one
+ * of the candidates of its ends and the successor or predecessor of
+ * this candidate. pos gives the position of every city in the tour.
+ */
+bool
+heuristic_oropt (const Graph *restrict graph,
+                 const Candidates *restrict candidates, City *restrict tour,
+                 City *restrict pos, City *restrict tmp)
+{
+    const size_t n = graph->n;
+    bool improved = false;
+
+    //
+    for (size_t length = 1; length <= MAX_SEGMENT && length + 2 < n; ++length)
+        for (size_t i = 0; i < n; ++i)
+            {
+                const City first = tour[i], last = tour[(i + length - 1) % n],
+                           prev = tour[PREV (i)],
+                           next = tour[(i + length) % n];
+                const Distance removed = DIST (prev, first)
+                                         + DIST (last, next)
+                                         - DIST (prev, next);
+
+// In the moved segment
+#define INSIDE(city) ((pos[city] + n - i) % n < length)
+
+                //
+                for (int end = 0; end < 2; ++end)
+                    {
+                        const City e = end ? last : first,
+                                   f = end ? first : last;
+
+                        for (size_t k = candidates->start[e];
+                             k < candidates->start[e + 1]; ++k)
+                            {
+                                const City c = candidates->list[k];
+                                const City c_next = tour[NEXT (pos[c])],
+                                           c_prev = tour[PREV (pos[c])];
+
+                                //
+                                if (DIST (e, c) + EPSILON >= removed)
+                                    break;
+                                if (INSIDE (c))
+                                    continue;
+
+                                // c, e, ..., f, c_next
+                                if (!INSIDE (c_next)
+                                    && DIST (e, c) + DIST (f, c_next)
+                                               - DIST (c, c_next) + EPSILON
+                                           < removed)
+                                    {
+                                        heuristic_move (tour, pos, tmp, n, i,
+                                                        length, c, e != first);
+                                        improved = true;
+                                        goto moved;
+                                    }
+
+                                // c_prev, f, ..., e, c
+                                if (!INSIDE (c_prev)
+                                    && DIST (e, c) + DIST (f, c_prev)
+                                               - DIST (c_prev, c) + EPSILON
+                                           < removed)
+                                    {
+                                        heuristic_move (tour, pos, tmp, n, i,
+                                                        length, c_prev,
+                                                        f != first);
+                                        improved = true;
+                                        goto moved;
+                                    }
+                            }
+                    }
+#undef INSIDE
+
+            moved:;
+            }
+
+    //
+    return improved;
+}
+
+/*
+ * Whether d(a, b) = d(b, a) for every edge, which the gains of the moves
+ * assume. The loaders refuse asymmetric matrices, and the distances of
+ * coordinates are computed alike both ways.
+ */
+static bool
+heuristic_symmetric (const Graph *restrict graph)
+{
+    const size_t n = graph->n;
+
+    //
+    if (graph->coords)
+        return true;
+    for (size_t a = 0; a < n; ++a)
+        for (size_t b = 0; b < a; ++b)
+            if (DIST (a, b) != DIST (b, a))
+                return false;
+    return true;
+}
+
+//
+Distance
+heuristic_tour (const Graph *restrict graph, City *restrict tour)
+{
+    const size_t n = graph->n;
+    const size_t starts
+        = MIN (n, MAX (MIN_STARTS, (size_t)omp_get_max_threads ()));
+    Candidates candidates
+        = candidates_nearest (graph, MIN (n - 1, NB_CANDIDATES));
+    Distance best = INFINITY;
+    bool found = false;
+
+    //
+    assert (heuristic_symmetric (graph));
+
+#pragma omp parallel
+    {
+        City *restrict _tour = malloc (n * sizeof (City));
+        City *restrict _pos = malloc (n * sizeof (City));
+        City *restrict _tmp = malloc (n * sizeof (City));
+        bool *restrict _visited = malloc (n * sizeof (bool));
+
+        //
+        if (!_tour || !_pos || !_tmp || !_visited)
+            perror ("malloc"), exit (254);
+
+        // Spreading the start cities
+#pragma omp for schedule(dynamic, 1)
+        for (size_t s = 0; s < starts; ++s)
+            {
+                Distance length;
+
+                //
+                heuristic_nearest (graph, s * n / starts, _tour, _visited);
+                for (size_t i = 0; i < n; ++i)
+                    _pos[_tour[i]] = i;
+
+                // Local search, until no move improves the tour
+                for (size_t pass = 0;
+                     pass < MAX_PASSES
+                     && (heuristic_2opt (graph, &candidates, _tour, _pos)
+                         || heuristic_oropt (graph, &candidates, _tour, _pos,
+                                             _tmp));
+                     ++pass)
+                    ;
+
+                //
+                length = tour_length (graph, _tour);
+#pragma omp critical
+                if (!found || length < best)
+                    {
+                        // Starting from the city 0
+                        for (size_t i = 0; i < n; ++i)
+                            tour[i] = _tour[(i + _pos[0]) % n];
+                        best = length;
+                        found = true;
+                    }
+            }
+
+        //
+        free (_tour);
+        free (_pos);
+        free (_tmp);
+        free (_visited);
+    }
+
+    //
+    candidates_free (&candidates);
+
+    //
+    return best;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -9,9 +9,49 @@
 #define _BB_H_
 
 #include "common.h"
+#include "graph.h"
+
+// Order in which the nodes are explored
+typedef enum
+{
+    BB_BEST,   // best bound first
+    BB_DEPTH,  // depth first, with work stealing between the threads
+    BB_HYBRID, // best bound first near the root, depth first below
+} Bbsearch;
+
+// Parameters of the search
+typedef struct
+{
+    /*
+     * leaf:   number of cities left under which a node is solved exactly
+     * search: exploration order
+     * depth:  depth from which the hybrid search goes depth first
+     * nodes:  number of open nodes from which it goes depth first anyway
+     * near:   candidates per city of the trees of the ascent, 0 for all
+     *         the edges, see prim_bound_ascent
+     */
+    size_t leaf;
+    Bbsearch search;
+    int depth;
+    long nodes;
+    size_t near;
+
+    /*
+     * checkpoint: file where the frontier is saved, NULL for none, see
+     *             checkpoint.h
+     * interval:   seconds between two checkpoints, which SIGUSR1 and
+     *             SIGTERM also request, the latter then stopping
+     * resume:     checkpoint the search starts from, NULL for the root
+     */
+    const char *checkpoint;
+    double interval;
+    const char *resume;
+} Bbparams;
 
 //
-Distance bb_solve (const Distance *restrict distances, const size_t n);
+Distance bb_solve (const Graph *restrict graph, City *restrict tour,
+                   const Distance upper_bound,
+                   const Bbparams *restrict params);
 
 #endif /* _BB_H_ */
 
@@ -0,0 +1,90 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the candidate neighbour lists
+ */
+
+#ifndef _CANDIDATES_H_
+#define _CANDIDATES_H_
+
+#include "common.h"
+#include "graph.h"
+
+/*
+ * Sorted candidate neighbours of every city, stored contiguously
+ * (CSR format): the candidates of a are list[start[a]] to
+ * list[start[a + 1] - 1], the best one first. Without lists (NULL), the
+ * candidates of a are every other city, see candidates_get.
+ */
+typedef struct
+{
+    size_t n;
+    size_t *restrict start;
+    City *restrict list;
+} Candidates;
+
+// Number of candidates of a
+static inline size_t
+candidates_count (const Candidates *restrict candidates, const City a)
+{
+    if (!candidates->list)
+        return candidates->n - 1;
+    return candidates->start[a + 1] - candidates->start[a];
+}
+
+// The i-th candidate of a
+static inline City
+candidates_get (const Candidates *restrict candidates, const City a,
+                const size_t i)
+{
+    if (!candidates->list)
+        return (City)i < a ? (City)i : (City)i + 1;
+    return candidates->list[candidates->start[a] + i];
+}
+
+// Tree of the root, from which the alpha-nearness of an edge is computed
+typedef struct
+{
+    /*
+     * pi:       penalties of the tree
+     * tree:     parent of every city, -1 for the root
+     * children: children of every city, in CSR format with first
+     */
+    size_t n;
+    Distance *restrict pi;
+    City *restrict tree, *restrict children;
+    size_t *restrict first;
+} Calpha;
+
+//
+Candidates candidates_nearest (const Graph *restrict graph, const size_t k);
+
+//
+Candidates candidates_alpha (const Graph *restrict graph,
+                             const Distance *restrict pi,
+                             const City *restrict tree, const size_t k);
+
+//
+Calpha candidates_alpha_create (const size_t n, const Distance *restrict pi,
+                                const City *restrict tree);
+
+//
+void candidates_alpha_row (const Graph *restrict graph,
+                           const Calpha *restrict alpha, const City a,
+                           Distance *restrict row, City *restrict stack,
+                           City *restrict from);
+
+//
+void candidates_alpha_free (Calpha *restrict alpha);
+
+//
+bool candidates_near (Graph *restrict graph,
+                      const Candidates *restrict candidates, const size_t k);
+
+//
+void candidates_free (Candidates *restrict candidates);
+
+#endif /* _CANDIDATES_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
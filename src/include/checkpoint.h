@@ -0,0 +1,151 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the checkpoints of the branch and bound
+ */
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include "common.h"
+#include "graph.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Binary format: a header, the n cities of the best tour, then a record
+ * per node of the frontier, followed by the depth + 1 cities of its path
+ * from the start and its n penalties, as floats (see Penalty). The values
+ * are in the byte order of the machine, as the matrices of reader.h.
+ */
+#define CHECKPOINT_MAGIC "TSPCHKPT"
+
+// Requests, by the signals or the clock
+#define CHECKPOINT_SAVE 1 // saving, SIGUSR1
+#define CHECKPOINT_STOP 2 // saving then stopping, SIGTERM
+
+//
+typedef struct
+{
+    /*
+     * magic: CHECKPOINT_MAGIC, without its null byte
+     * n:     number of cities
+     * hash:  of the matrix, the search resuming on the same one only
+     * nodes: number of nodes of the frontier
+     */
+    char magic[8];
+    uint64_t n, hash, nodes;
+
+    /*
+     * value:   length of the best tour, INFINITY if none is known
+     * elapsed: seconds of search so far
+     * others:  counters of the search so far
+     */
+    Distance value;
+    double elapsed;
+    int64_t iterations, leaves, swept, improvements;
+} Cheader;
+
+// Node of the frontier, without its path and penalties
+typedef struct
+{
+    Distance value, tour;
+    int32_t position, depth;
+} Crecord;
+
+/*
+ * Snapshot of the frontier, copied in memory while the search waits, then
+ * written by a background thread while it goes on. The file is replaced
+ * at once, through a temporary one, so that a crash leaves the previous
+ * checkpoint.
+ */
+typedef struct
+{
+    /*
+     * file:      path of the checkpoint
+     * temporary: file followed by ".tmp", written first
+     * hash:      of the matrix, see checkpoint_hash
+     * cities:    the cities of a path
+     */
+    const char *file;
+    char *temporary;
+    uint64_t hash;
+    size_t n;
+    City *cities;
+
+    /*
+     * buffer:  snapshot, of size bytes within capacity
+     * header:  of the snapshot, completed once every node is copied
+     * thread:  writing the buffer, if started
+     * writing: set until it is written
+     */
+    char *buffer;
+    size_t size, capacity;
+    Cheader header;
+    pthread_t thread;
+    bool started;
+    atomic_bool writing;
+} Checkpoint;
+
+// Checkpoint read back, its nodes being read one by one
+typedef struct
+{
+    /*
+     * header: of the file
+     * tour:   best tour of the file, meaningless if header.value is
+     *         INFINITY
+     * data:   the nodes, read from offset, of size bytes
+     */
+    Cheader header;
+    City *tour;
+    char *data;
+    size_t size, offset;
+} Cresume;
+
+//
+uint64_t checkpoint_hash (const Graph *restrict graph);
+
+//
+Checkpoint checkpoint_create (const char *restrict file,
+                              const Graph *restrict graph);
+
+// Catching SIGUSR1 and SIGTERM, see checkpoint_signal
+void checkpoint_signals (void);
+
+// Requests of the signals caught since the last call, 0 if none
+int checkpoint_signal (void);
+
+//
+bool checkpoint_busy (Checkpoint *restrict checkpoint);
+
+//
+void checkpoint_begin (Checkpoint *restrict checkpoint,
+                       const Cheader *restrict header,
+                       const City *restrict tour);
+
+//
+void checkpoint_node (Checkpoint *restrict checkpoint,
+                      const Node *restrict node);
+
+//
+void checkpoint_end (Checkpoint *restrict checkpoint);
+
+//
+void checkpoint_free (Checkpoint *restrict checkpoint);
+
+//
+Cresume checkpoint_read (const char *restrict file,
+                         const Graph *restrict graph);
+
+//
+bool checkpoint_next (Cresume *restrict resume, Crecord *restrict record,
+                      City *restrict cities, Penalty *restrict pi);
+
+//
+void checkpoint_close (Cresume *restrict resume);
+
+#endif /* _CHECKPOINT_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
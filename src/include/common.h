@@ -12,6 +12,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Check infinity from math.h */
 #ifndef INFINITY
@@ -21,19 +22,79 @@
 //
 typedef double Distance;
 
+/*
+ * Weight of an edge in the distance matrices, picked at compile time by
+ * make WEIGHT=double|float|int. float and int halve the matrices, and so
+ * what the Prim kernels read; int is exact for integer instances. The
+ * bounds and penalties stay fractional Distances: DISTANCE converts a
+ * weight when it is read, a missing edge (WEIGHT_MISSING) to INFINITY.
+ */
+#if defined(WEIGHT_INT)
+typedef int32_t Weight;
+#define WEIGHT_NAME "int"
+#define WEIGHT_MISSING INT32_MAX
+#define DISTANCE(w) ((w) == WEIGHT_MISSING ? INFINITY : (Distance)(w))
+#elif defined(WEIGHT_FLOAT)
+typedef float Weight;
+#define WEIGHT_NAME "float"
+#define WEIGHT_MISSING INFINITY
+#define DISTANCE(w) ((Distance)(w))
+#else
+typedef double Weight;
+#define WEIGHT_NAME "double"
+#define WEIGHT_MISSING INFINITY
+#define DISTANCE(w) (w)
+#endif
+
 //
 typedef int City;
 
+/*
+ * Held-Karp penalty of a node, stored as a float: half the memory of a
+ * Distance, for every node of the frontier. The ascent runs on Distances,
+ * and any penalties give a valid bound, so that the rounding only moves
+ * where the ascent of the children starts from.
+ */
+typedef float Penalty;
+
+/*
+ * Penalties shared by the children of a node, as the steps of their paths,
+ * see Step: pi, the n penalties, and refs, the number of nodes holding
+ * them
+ */
+typedef struct
+{
+    int refs;
+    Penalty pi[];
+} Penalties;
+
+// A city of a partial tour, see path.h
+typedef struct Step
+{
+    /*
+     * parent: previous step, NULL for the start city
+     * city:   city reached by this step
+     * refs:   number of children and nodes holding the step
+     */
+    struct Step *parent;
+    City city;
+    int refs;
+} Step;
+
 //
 typedef struct
 {
     /*
-     * reached:  list of reached city, such that:
-     *            - 0 means not reached
-     *            - n means reached at step n
-     * position: position of the travelling salesman
+     * path: last step of the partial tour, the degree of the
+     *       cities is rebuilt from it when the node is branched
      */
-    City *reached, position;
+    Step *path;
+
+    /*
+     * pi: Held-Karp penalties where the ascent of the children starts
+     *     from, shared with the siblings, see Penalties
+     */
+    Penalties *pi;
 
     /*
      * value: value of the bound
@@ -41,7 +102,11 @@ typedef struct
      */
     Distance value, tour;
 
-    //
+    /*
+     * position: position of the travelling salesman
+     * depth:    number of steps
+     */
+    City position;
     int depth;
 } Node;
 
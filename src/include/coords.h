@@ -0,0 +1,106 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the distances computed from coordinates
+ */
+
+#ifndef _COORDS_H_
+#define _COORDS_H_
+
+#include "common.h"
+
+// Distance functions of TSPLIB
+typedef enum
+{
+    COORDS_EUC_2D,
+    COORDS_CEIL_2D,
+    COORDS_GEO,
+    COORDS_ATT
+} Ctype;
+
+/*
+ * Cities given by their coordinates, as two arrays (SoA), so that a row
+ * of distances is computed by a loop over contiguous values.
+ */
+typedef struct
+{
+    /*
+     * x, y: coordinates, latitude and longitude in radians for COORDS_GEO
+     */
+    Ctype type;
+    size_t n;
+    double *restrict x, *restrict y;
+} Coords;
+
+// Constants of the GEO distance, as in TSPLIB
+#define COORDS_PI 3.141592
+#define COORDS_RRR 6378.388
+
+// Distance of the coordinates (xa, ya) and (xb, yb), b != a
+static inline Distance
+coords_kernel (const Ctype type, const double xa, const double ya,
+               const double xb, const double yb)
+{
+    const double dx = xa - xb, dy = ya - yb;
+
+    //
+    switch (type)
+        {
+        case COORDS_EUC_2D:
+            return floor (sqrt (dx * dx + dy * dy) + 0.5);
+        case COORDS_CEIL_2D:
+            return ceil (sqrt (dx * dx + dy * dy));
+        case COORDS_ATT:
+            {
+                const double r = sqrt ((dx * dx + dy * dy) / 10.0),
+                             t = floor (r + 0.5);
+
+                return t < r ? t + 1 : t;
+            }
+        case COORDS_GEO:
+            {
+                const double q1 = cos (ya - yb), q2 = cos (dx),
+                             q3 = cos (xa + xb);
+
+                return floor (COORDS_RRR
+                                  * acos (0.5
+                                          * ((1.0 + q1) * q2
+                                             - (1.0 - q1) * q3))
+                              + 1.0);
+            }
+        }
+
+    //
+    return INFINITY;
+}
+
+// Distance of the cities a and b, INFINITY if a = b
+static inline Distance
+coords_distance (const Coords *restrict coords, const City a, const City b)
+{
+    if (a == b)
+        return INFINITY;
+    return coords_kernel (coords->type, coords->x[a], coords->y[a],
+                          coords->x[b], coords->y[b]);
+}
+
+//
+Coords coords_create (const size_t n, const Ctype type);
+
+//
+void coords_geo (Coords *restrict coords);
+
+//
+void coords_row (const Coords *restrict coords, const City a,
+                 const size_t count, Weight *restrict row);
+
+//
+Weight *coords_matrix (const Coords *restrict coords);
+
+//
+void coords_free (Coords *restrict coords);
+
+#endif /* _COORDS_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,64 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the work-stealing deque
+ */
+
+#ifndef _DEQUE_H_
+#define _DEQUE_H_
+
+#include "common.h"
+#include <stdatomic.h>
+
+// Circular array of nodes, size being a power of 2
+typedef struct
+{
+    size_t size;
+    Node nodes[];
+} Darray;
+
+/*
+ * Chase-Lev deque: its owner pushes and pops at the bottom, the other
+ * threads steal at the top, all without lock.
+ */
+typedef struct
+{
+    /*
+     * top:    next node to steal
+     * bottom: next free slot of the owner
+     * array:  current array, replaced by a twice larger one when full
+     */
+    atomic_long top, bottom;
+    _Atomic (Darray *) array;
+
+    /*
+     * retired: previous arrays, which a thief may still be reading, kept
+     *          until the deque is freed
+     */
+    Darray **retired;
+    size_t nb_retired;
+} __attribute__ ((aligned (64))) Deque;
+
+//
+Deque deque_create (const size_t capacity);
+
+//
+void deque_push (Deque *restrict deque, const Node *restrict node);
+
+//
+bool deque_pop (Deque *restrict deque, Node *restrict node);
+
+//
+bool deque_steal (Deque *restrict deque, Node *restrict node);
+
+//
+void deque_each (const Deque *restrict deque,
+                 void (*visit) (const Node *restrict, void *), void *data);
+
+//
+void deque_free (Deque *restrict deque);
+
+#endif /* _DEQUE_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
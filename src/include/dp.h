@@ -0,0 +1,47 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the exact dynamic programming on small subproblems
+ */
+
+#ifndef _DP_H_
+#define _DP_H_
+
+#include "common.h"
+#include "graph.h"
+
+// Per-thread workspace of the dynamic programming
+typedef struct
+{
+    /*
+     * size:   maximum number of cities left
+     * k:      number of cities left in the last path
+     * table:  best path for every subset and last city, a row per subset
+     * link:   distances between the cities left, by arrival city
+     * first:  distances from the first city
+     * last:   distances to the last city
+     * cities: cities left
+     */
+    size_t size, k;
+    Distance *restrict table, *restrict link, *restrict first, *restrict last;
+    City *restrict cities;
+} Dpwork;
+
+//
+Dpwork dpwork_create (const size_t size);
+
+//
+void dpwork_free (Dpwork *restrict dpwork);
+
+//
+Distance dp_path (Dpwork *restrict dpwork, const Graph *restrict graph,
+                  const City *restrict degree, const City from,
+                  const City to);
+
+//
+void dp_order (const Dpwork *restrict dpwork, City *restrict order);
+
+#endif /* _DP_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
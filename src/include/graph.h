@@ -0,0 +1,208 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the graph given to the bounding algorithms
+ */
+
+#ifndef _GRAPH_H_
+#define _GRAPH_H_
+
+#include "common.h"
+#include "coords.h"
+
+/*
+ * The distance matrix is stored by rows of STRIDE (n) distances, n padded
+ * to a multiple of TILE: the distance of (a, b) is at a STRIDE (n) + b.
+ * The TILE distances of a to the J-th TILE cities are contiguous, a vector
+ * of the dense Prim, and the bits of their removed edges are a byte of a
+ * word of the bitsets of edges. The distances past n are never read.
+ *
+ * With GRAPH_TRIANGLE (make LAYOUT=triangle), the matrix being symmetric,
+ * only the tiles of TILE x TILE distances on and below the diagonal are
+ * stored, half of the memory: the tile (I, J), J <= I, after the
+ * I (I + 1) / 2 + J tiles before it, holds the distances of the cities
+ * I TILE + r to the cities J TILE + c at r TILE + c. A tile is a word of
+ * the bitsets. The row of a city is read from a row of the tiles up to the
+ * diagonal, but gathered from a column of the ones below it, which is
+ * about twice as slow.
+ */
+#define TILE 8
+
+// Number of tiles of a side of the matrix of n cities, length of its rows
+#define TILES(n) (((size_t)(n) + TILE - 1) / TILE)
+#define STRIDE(n) (TILES (n) * TILE)
+
+/*
+ * Number of distances of the matrix of n cities, and step from the TILE
+ * distances of a city to the next TILE cities to the ones after them, up
+ * to the diagonal in a triangle
+ */
+#if defined(GRAPH_TRIANGLE)
+#define MATRIX_SIZE(n) (TILES (n) * (TILES (n) + 1) / 2 * TILE * TILE)
+#define MATRIX_STEP (TILE * TILE)
+#else
+#define MATRIX_SIZE(n) (STRIDE (n) * STRIDE (n))
+#define MATRIX_STEP TILE
+#endif
+
+// Position of the first distance of the tile (I, J), J <= I, of a triangle
+static inline size_t
+graph_tile (const size_t i, const size_t j)
+{
+    return (i * (i + 1) / 2 + j) * TILE * TILE;
+}
+
+/*
+ * Whether the distances of the I-th TILE cities to the J-th ones are read
+ * by columns, every TILE distances, above the diagonal of a triangle
+ */
+static inline bool
+graph_column (const size_t i, const size_t j)
+{
+#if defined(GRAPH_TRIANGLE)
+    return i < j;
+#else
+    return (void)i, (void)j, false;
+#endif
+}
+
+// Position of the distance of (a, b) in the matrix of n cities, see TILE
+static inline size_t
+graph_index (const size_t n, const size_t a, const size_t b)
+{
+#if defined(GRAPH_TRIANGLE)
+    const size_t i = a / TILE, j = b / TILE;
+
+    //
+    (void)n;
+    if (graph_column (i, j))
+        return graph_tile (j, i) + b % TILE * TILE + a % TILE;
+    return graph_tile (i, j) + a % TILE * TILE + b % TILE;
+#else
+    return a * STRIDE (n) + b;
+#endif
+}
+
+/*
+ * Whether the distance of (a, b) has its own place in the matrix, rather
+ * than the one of (b, a). Once false for a, it stays so for the next b.
+ */
+static inline bool
+graph_stored (const size_t a, const size_t b)
+{
+    return !graph_column (a / TILE, b / TILE);
+}
+
+//
+typedef struct
+{
+    /*
+     * distances: distance matrix (see TILE), WEIGHT_MISSING for
+     *            missing edges, NULL if coords is given
+     * coords:    cities whose distances are computed when read, in O(n)
+     *            memory, instead of a matrix, NULL if none
+     * removed:   bitset of the edges removed from the matrix, by their
+     *            position in it, NULL if none is. It may be set by
+     *            other threads while the graph is read.
+     * n:         number of cities
+     */
+    const Weight *restrict distances;
+    const Coords *restrict coords;
+    const uint64_t *removed;
+    size_t n;
+
+    /*
+     * Adjacency lists of the finite edges, in CSR format: the neighbours
+     * of a are adjacent[start[a]] to adjacent[start[a + 1] - 1].
+     * NULL for dense graphs, whose rows are walked in full.
+     */
+    size_t *restrict start;
+    City *restrict adjacent;
+
+    /*
+     * Subgraph of the few best candidate edges of every city, in the same
+     * format, on which the Held-Karp ascent may build its trees (see
+     * prim_bound_ascent). NULL if there is none.
+     */
+    size_t *restrict near_start;
+    City *restrict near;
+} Graph;
+
+/*
+ * Word of the bits of the removed edges around the position i of the
+ * matrix, in the bitset removed of a graph, 0 if none is
+ */
+static inline uint64_t
+graph_removed (const uint64_t *removed, const size_t i)
+{
+    uint64_t word = 0;
+
+    //
+    if (removed)
+        {
+#pragma omp atomic read
+            word = removed[i / (TILE * TILE)];
+        }
+    return word;
+}
+
+/*
+ * Distance of the edge (a, b) of a != b at the position i of the matrix,
+ * INFINITY if it is missing, whether it was removed or not: the weight of
+ * an edge of a tree built before a concurrent reduction removed it
+ */
+static inline Distance
+graph_weight (const Graph *restrict graph, const City a, const City b,
+              const size_t i)
+{
+    return graph->coords ? coords_distance (graph->coords, a, b)
+                         : DISTANCE (graph->distances[i]);
+}
+
+/*
+ * Distance of the edge (a, b), INFINITY if it is missing, removed, or if
+ * a = b. Every kernel reads the matrix through it (the DIST macros), but
+ * the rows of the dense Prim, see prim_relax.c. The edges of coordinates
+ * keep their position in the matrix for the bitset of the removed ones.
+ */
+static inline Distance
+graph_distance (const Graph *restrict graph, const City a, const City b)
+{
+    size_t i;
+
+    //
+    if (a == b)
+        return INFINITY;
+    i = graph_index (graph->n, a, b);
+    if (graph_removed (graph->removed, i) >> (i % (TILE * TILE)) & 1)
+        return INFINITY;
+    return graph_weight (graph, a, b, i);
+}
+
+//
+Weight *graph_matrix (const size_t n);
+
+//
+Graph graph_create (const Weight *restrict distances, const size_t n);
+
+//
+Graph graph_coords (const Coords *restrict coords);
+
+//
+Graph graph_reduce (const Graph *restrict graph,
+                    const uint64_t *removed);
+
+//
+void graph_row (const Graph *restrict graph, const City a,
+                Weight *restrict row);
+
+//
+void graph_adjacency (Graph *restrict graph);
+
+//
+void graph_free (Graph *restrict graph);
+
+#endif /* _GRAPH_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
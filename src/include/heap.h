@@ -2,7 +2,7 @@
  * PEDERSEN Ny Aina
  * license: Unlicense
  *
- * Binary heap module's header
+ * 4-ary heap module's header
  */
 
 #ifndef _HEAP_H_
@@ -10,11 +10,25 @@
 
 #include "common.h"
 
+// Key of a node in the heap, its payload being in the slot slot
+typedef struct
+{
+    Distance value;
+    size_t slot;
+} Hkey;
+
 //
 typedef struct
 {
-    size_t size, capacity;
-    Node *restrict heap;
+    /*
+     * keys:    the heap, ordered by value
+     * nodes:   payloads, in the slots of their keys
+     * free:    slots of the popped nodes, nb_free of them
+     */
+    size_t size, capacity, nb_free;
+    Hkey *restrict keys;
+    Node *restrict nodes;
+    size_t *restrict free;
 } Heap;
 
 //
@@ -26,6 +40,17 @@ void heap_push (Heap *restrict heap, const Node *restrict node);
 //
 Node heap_pop (Heap *restrict heap);
 
+//
+Distance heap_top (const Heap *restrict heap);
+
+//
+size_t heap_prune (Heap *restrict heap, const Distance bound,
+                   void (*drop) (Node *restrict, void *), void *data);
+
+//
+void heap_each (const Heap *restrict heap,
+                void (*visit) (const Node *restrict, void *), void *data);
+
 //
 bool heap_empty (const Heap *restrict heap);
 
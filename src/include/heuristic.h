@@ -0,0 +1,26 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the heuristic tours
+ */
+
+#ifndef _HEURISTIC_H_
+#define _HEURISTIC_H_
+
+#include "candidates.h"
+#include "common.h"
+#include "graph.h"
+
+//
+Distance heuristic_tour (const Graph *restrict graph, City *restrict tour);
+
+//
+bool heuristic_oropt (const Graph *restrict graph,
+                      const Candidates *restrict candidates,
+                      City *restrict tour, City *restrict pos,
+                      City *restrict tmp);
+
+#endif /* _HEURISTIC_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,58 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the shared incumbent, the best tour known
+ */
+
+#ifndef _INCUMBENT_H_
+#define _INCUMBENT_H_
+
+#include "common.h"
+#include <stdatomic.h>
+
+/*
+ * Best tour known by the threads. Its length is read and lowered without
+ * lock, by compare-and-swap. The tour itself is published under a
+ * seqlock: the readers retry while a writer is copying it.
+ */
+typedef struct
+{
+    /*
+     * value:        length of the best tour
+     * improvements: number of times value was lowered
+     */
+    _Atomic Distance value;
+    atomic_long improvements;
+
+    /*
+     * seq:    odd while a writer is copying a tour
+     * length: length of the tour in tour, INFINITY if none is known
+     * tour:   the n cities of the tour
+     */
+    atomic_uint seq;
+    _Atomic Distance length;
+    _Atomic City *tour;
+    size_t n;
+} __attribute__ ((aligned (64))) Incumbent;
+
+//
+Incumbent incumbent_create (const size_t n, const Distance value,
+                            const City *restrict tour);
+
+//
+Distance incumbent_value (const Incumbent *restrict incumbent);
+
+//
+bool incumbent_improve (Incumbent *restrict incumbent, const Distance value,
+                        const City *restrict tour);
+
+//
+Distance incumbent_tour (Incumbent *restrict incumbent, City *restrict tour);
+
+//
+void incumbent_free (Incumbent *restrict incumbent);
+
+#endif /* _INCUMBENT_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,20 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the Lin-Kernighan local search
+ */
+
+#ifndef _LK_H_
+#define _LK_H_
+
+#include "common.h"
+#include "graph.h"
+
+//
+Distance lk_tour (const Graph *restrict graph, City *restrict tour,
+                  const size_t kicks);
+
+#endif /* _LK_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,63 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the concurrent multi-queue frontier
+ */
+
+#ifndef _MQUEUE_H_
+#define _MQUEUE_H_
+
+#include "common.h"
+#include "heap.h"
+#include <omp.h>
+
+/*
+ * One shard of the multi-queue: a 4-ary heap behind its own lock.
+ * top and size mirror the heap's root and size so that the pop
+ * heuristic can compare shards without locking them.
+ */
+typedef struct
+{
+    omp_lock_t lock;
+    Heap heap;
+    Distance top;
+    size_t size;
+} __attribute__ ((aligned (64))) Squeue;
+
+//
+typedef struct
+{
+    size_t size;
+    Squeue *restrict queues;
+} Mqueue;
+
+//
+Mqueue mqueue_create (const size_t size, const size_t capacity);
+
+//
+void mqueue_push (Mqueue *restrict mqueue, const Node *restrict node,
+                  unsigned *restrict seed);
+
+//
+void mqueue_push_batch (Mqueue *restrict mqueue, const Node *restrict nodes,
+                        const size_t count, unsigned *restrict seed);
+
+//
+bool mqueue_pop (Mqueue *restrict mqueue, Node *restrict node,
+                 unsigned *restrict seed);
+
+//
+size_t mqueue_prune (Mqueue *restrict mqueue, const Distance bound,
+                     void (*drop) (Node *restrict, void *), void *data);
+
+//
+void mqueue_each (Mqueue *restrict mqueue,
+                  void (*visit) (const Node *restrict, void *), void *data);
+
+//
+void mqueue_free (Mqueue *restrict mqueue);
+
+#endif /* _MQUEUE_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
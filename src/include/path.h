@@ -0,0 +1,33 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the shared partial tours
+ */
+
+#ifndef _PATH_H_
+#define _PATH_H_
+
+#include "common.h"
+#include "pool.h"
+
+//
+Step *path_create (Pool *restrict pool, const City city);
+
+//
+Step *path_extend (Pool *restrict pool, Step *restrict parent,
+                   const City city);
+
+//
+void path_release (Pool *restrict pool, Step *restrict step);
+
+//
+void path_degrees (const Step *restrict step, City *restrict degree,
+                   const size_t n);
+
+//
+size_t path_cities (const Step *restrict step, City *restrict cities);
+
+#endif /* _PATH_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,39 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the renumbering of the cities
+ */
+
+#ifndef _PERMUTE_H_
+#define _PERMUTE_H_
+
+#include "common.h"
+#include "coords.h"
+#include "graph.h"
+
+/*
+ * An order of the cities is an array where order[i] is the city of the
+ * input which becomes the city i.
+ */
+
+// Along a Hilbert curve over the bounding box of the coordinates
+City *permute_hilbert (const Coords *restrict coords);
+
+// Each city followed by its nearest remaining neighbour, from the city 0
+City *permute_nearest (const Graph *restrict graph);
+
+//
+void permute_coords (Coords *restrict coords, const City *restrict order);
+
+// The matrix of graph, renumbered
+Weight *permute_matrix (const Graph *restrict graph,
+                        const City *restrict order);
+
+// Back to the cities of the input, from the city 0
+void permute_tour (City *restrict tour, const size_t n,
+                   const City *restrict order);
+
+#endif /* _PERMUTE_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
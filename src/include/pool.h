@@ -0,0 +1,52 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the fixed-size block allocator
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include "common.h"
+
+/*
+ * Blocks are carved from large slabs, and recycled through a free list.
+ * A pool is not thread safe, each thread owns its own. A block may be given
+ * back to another pool than the one it came from.
+ */
+typedef struct
+{
+    /*
+     * block:    size of a block in bytes
+     * count:    number of blocks per slab
+     * used:     number of blocks already carved from the last slab
+     * slab:     last allocated slab, slabs are chained by their first word
+     * freelist: blocks given back, chained by their first word
+     */
+    size_t block, count, used;
+    void *slab, *freelist;
+
+    /*
+     * gets:   number of blocks handed out
+     * puts:   number of blocks given back
+     * slabs:  number of calls to the system allocator
+     */
+    size_t gets, puts, slabs;
+} __attribute__ ((aligned (64))) Pool;
+
+//
+Pool pool_create (const size_t block);
+
+//
+void *pool_get (Pool *restrict pool);
+
+//
+void pool_put (Pool *restrict pool, void *restrict block);
+
+//
+void pool_free (Pool *restrict pool);
+
+#endif /* _POOL_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -8,16 +8,92 @@
 #ifndef _PRIM_H_
 #define _PRIM_H_
 
+#include "candidates.h"
 #include "common.h"
+#include "graph.h"
 #include "prim_heap.h"
+#include "prim_relax.h"
+
+// Per-thread workspace of the Prim kernels
+typedef struct
+{
+    /*
+     * pheap: heap of the sparse kernel
+     * key:   distance of a city to the tree, for the dense kernel
+     * bias:  penalty of a city, INFINITY if it cannot be linked
+     * prec:  closest city of the tree, then parent in the last tree
+     * pi:    penalties of the best bound of the ascent
+     * near:  penalties of the best estimate of the ascent, see
+     *        prim_bound_ascent
+     * label: subtree of every city, for the repairs
+     * stack: walk of the tree, for the repairs
+     * row:   distances of the last city of the dense Prim, computed from
+     *        the coordinates of the graph, see coords_row
+     * relax: relax-and-argmin kernel of the dense Prim
+     */
+    Pheap pheap;
+    Distance *restrict key, *restrict bias, *restrict pi, *restrict near;
+    City *restrict prec, *restrict label, *restrict stack;
+    Weight *restrict row;
+    Prelax relax;
+} Pwork;
+
+// Tree of a node, shared by the bounds of its children
+typedef struct
+{
+    /*
+     * prec:     parent of every open city, -1 for the root and the others
+     * children: children of every city, in CSR format with first
+     * weight:   penalised weight of the tree
+     */
+    City *restrict prec, *restrict children;
+    size_t *restrict first;
+    Distance weight;
+} Ptree;
+
+//
+Pwork pwork_create (const size_t n);
+
+//
+void pwork_free (Pwork *restrict pwork);
+
+//
+Ptree ptree_create (const size_t n);
+
+//
+void ptree_free (Ptree *restrict ptree);
 
 //
-Distance prim_bound_mst (Pheap *restrict pheap, const Distance *restrict,
-                         const City *restrict, size_t n);
+Distance prim_bound_mst (Pwork *restrict pwork, const Graph *restrict graph,
+                         const City *restrict reached);
+
+Distance prim_bound_1tree_opt (Pwork *restrict pwork,
+                               const Graph *restrict graph,
+                               const City *restrict reached,
+                               Distance *restrict pi, City *restrict tmp,
+                               const Distance target,
+                               const size_t iterations);
+
+void prim_tree (Pwork *restrict pwork, const Graph *restrict graph,
+                const City *restrict reached, const Distance *restrict pi,
+                City *restrict degree, Ptree *restrict ptree);
+
+Distance prim_first_tree (Pwork *restrict pwork, const Graph *restrict graph,
+                          const Candidates *restrict edges,
+                          const Ptree *restrict ptree, const City removed,
+                          const City *restrict reached,
+                          const Distance *restrict pi, City *restrict degree);
+
+Distance prim_bound_ascent (Pwork *restrict pwork, const Graph *restrict graph,
+                            const City *restrict reached,
+                            Distance *restrict pi, City *restrict degree,
+                            Distance mst_weight, const Distance target,
+                            const size_t iterations);
 
-Distance prim_bound_1tree_opt (Pheap *restrict pheap, const Distance *restrict,
-                               const City *restrict, size_t n,
-                               Distance *restrict tmp1, City *restrict tmp2);
+Distance prim_bound_tree (Pwork *restrict pwork, const Graph *restrict graph,
+                          const City *restrict reached, Distance *restrict pi,
+                          City *restrict tmp, City *restrict tree,
+                          const Distance target, const size_t iterations);
 
 #endif /* _PRIM_H_ */
 
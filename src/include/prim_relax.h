@@ -0,0 +1,37 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the relax-and-argmin kernels of the dense Prim
+ */
+
+#ifndef _PRELAX_H_
+#define _PRELAX_H_
+
+#include "common.h"
+#include "graph.h"
+
+/*
+ * For every city c of the graph, with d (last, c) its distance:
+ *   key[c] = min (key[c], d (last, c) + shift + bias[c]),
+ *   prec[c] = last if updated
+ * then returns the city with the smallest key (the first one on ties), -1
+ * if every key is INFINITY, and its key in best. The row of last is read
+ * from the matrix, see TILE, or from row, NULL but for the graphs of
+ * coordinates (see coords_row), bias[last] being INFINITY.
+ */
+typedef City (*Prelax) (const Graph *restrict graph, const City last,
+                        const Weight *restrict row, const Distance shift,
+                        const Distance *restrict bias,
+                        Distance *restrict key, City *restrict prec,
+                        Distance *restrict best);
+
+// Best kernel for the running CPU
+Prelax prim_relax_select (void);
+
+// Name of the kernel, for the logs
+const char *prim_relax_name (const Prelax relax);
+
+#endif /* _PRELAX_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
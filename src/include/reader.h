@@ -9,9 +9,99 @@
 #define _READER_H_
 
 #include "common.h"
+#include "coords.h"
+#include <stdint.h>
+
+/*
+ * Binary format: a header, then the matrix from offset, a multiple of
+ * READER_ALIGN, so that the file is mapped as is. The matrix is in the
+ * layout of the build which wrote it, see TILE: its rows padded to whole
+ * tiles (READER_PADDED) or the tiles of its lower triangle (READER_TILED),
+ * or its n rows in the files of older versions. A file of the layout and
+ * type of the build is mapped, the others are converted. The values are
+ * in the byte order of the machine, missing edges are INFINITY, or
+ * INT32_MAX for integers.
+ */
+#define READER_MAGIC "TSPMATRX"
+#define READER_ALIGN 4096
+
+// Type of the values
+typedef enum
+{
+    READER_DOUBLE = 1,
+    READER_FLOAT,
+    READER_INT32
+} Rtype;
+
+// Type of the Weight of the build, which is mapped without conversion
+#if defined(WEIGHT_INT)
+#define READER_WEIGHT READER_INT32
+#elif defined(WEIGHT_FLOAT)
+#define READER_WEIGHT READER_FLOAT
+#else
+#define READER_WEIGHT READER_DOUBLE
+#endif
+
+// Flags of the matrix
+#define READER_SYMMETRIC 1u
+#define READER_TILED 2u
+#define READER_PADDED 4u
+
+// Layout of the matrices of the build, see graph.h
+#if defined(GRAPH_TRIANGLE)
+#define READER_LAYOUT READER_TILED
+#else
+#define READER_LAYOUT READER_PADDED
+#endif
+
+//
+typedef struct
+{
+    /*
+     * magic:  READER_MAGIC, without its null byte
+     * n:      number of cities
+     * type:   type of the values, see Rtype
+     * flags:  READER_SYMMETRIC if d(a, b) = d(b, a), and the layout of
+     *         the matrix, READER_PADDED or READER_TILED
+     * offset: of the first row in the file
+     */
+    char magic[8];
+    uint64_t n;
+    uint32_t type, flags;
+    uint64_t offset;
+} Rheader;
+
+// Distance matrix of a file, read or mapped
+typedef struct
+{
+    /*
+     * distances: matrix, see TILE, NULL for coordinates
+     * coords:    cities of a TSPLIB file of coordinates, whose distances
+     *            are computed when read, of n = 0 for a matrix
+     * map:       mapping of the file, of length bytes, NULL if read
+     * order:     city of the file of every city of the matrix, NULL if
+     *            they are not renumbered, see permute.h
+     */
+    Weight *restrict distances;
+    Coords coords;
+    size_t n;
+    void *map;
+    size_t length;
+    City *order;
+} Matrix;
+
+//
+Matrix reader (const char *restrict file, const bool permute);
+
+//
+bool reader_weight (const Distance value, Weight *restrict weight);
+
+//
+void reader_write (const char *restrict file,
+                   const Weight *restrict distances, const size_t n);
 
 //
-Distance *restrict reader (const char *restrict file, size_t *n);
+void reader_free (Matrix *restrict matrix);
 
 #endif /* _READER_H_ */
 
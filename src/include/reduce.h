@@ -0,0 +1,54 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the reduced cost edge elimination
+ */
+
+#ifndef _REDUCE_H_
+#define _REDUCE_H_
+
+#include "candidates.h"
+#include "common.h"
+#include "graph.h"
+
+// Edges that no tour shorter than the best known one can use
+typedef struct
+{
+    /*
+     * graph:      the graph before any elimination
+     * eliminated: bitset of the eliminated edges, by their position in
+     *             the matrix, see graph_reduce
+     * alpha:      tree of the root, giving the alpha-nearness of the
+     *             edges a row at a time
+     * bound:      Held-Karp bound of the root
+     */
+    const Graph *graph;
+    uint64_t *eliminated;
+    Calpha alpha;
+    Distance bound;
+
+    /*
+     * n:       number of cities
+     * edges:   number of edges of the graph
+     * removed: number of edges eliminated
+     */
+    size_t n, edges, removed;
+} Reduce;
+
+//
+Reduce reduce_create (const Graph *restrict graph, const Distance *restrict pi,
+                      const City *restrict tree, const Distance bound);
+
+//
+size_t reduce_edges (Reduce *restrict reduce, const Distance best);
+
+//
+Candidates reduce_candidates (const Reduce *restrict reduce);
+
+//
+void reduce_free (Reduce *restrict reduce);
+
+#endif /* _REDUCE_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,23 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the tour utilities
+ */
+
+#ifndef _TOUR_H_
+#define _TOUR_H_
+
+#include "common.h"
+#include "graph.h"
+
+//
+Distance tour_length (const Graph *restrict graph, const City *restrict tour);
+
+//
+bool tour_verify (const Graph *restrict graph, const City *restrict tour,
+                  const Distance length);
+
+#endif /* _TOUR_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,19 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Header for the TSPLIB reader
+ */
+
+#ifndef _TSPLIB_H_
+#define _TSPLIB_H_
+
+#include "common.h"
+#include "reader.h"
+
+//
+Matrix tsplib_read (const char *restrict file, const bool permute);
+
+#endif /* _TSPLIB_H_ */
+
+/* vim: set ts=8 sts=4 sw=4 et : */
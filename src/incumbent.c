@@ -0,0 +1,149 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Shared incumbent implementation.
+ *
+ * The length is a 64 bits atomic, lowered by compare-and-swap: a thread
+ * prunes against the last value with a plain load. The tour goes through
+ * a seqlock, whose writers take turns on the sequence number and whose
+ * readers never block them. A writer whose tour was beaten in the
+ * meantime does not copy it.
+ */
+
+#include "incumbent.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+Incumbent
+incumbent_create (const size_t n, const Distance value,
+                  const City *restrict tour)
+{
+    Incumbent incumbent;
+
+    //
+    incumbent.n = n;
+    incumbent.tour = malloc (n * sizeof (City));
+    if (!incumbent.tour)
+        perror ("malloc"), exit (254);
+
+    //
+    atomic_init (&incumbent.value, value);
+    atomic_init (&incumbent.improvements, 0);
+    atomic_init (&incumbent.seq, 0);
+    atomic_init (&incumbent.length, tour ? value : INFINITY);
+    for (size_t i = 0; i < n; ++i)
+        atomic_init (incumbent.tour + i, tour ? tour[i] : -1);
+
+    //
+    return incumbent;
+}
+
+//
+inline Distance
+incumbent_value (const Incumbent *restrict incumbent)
+{
+    return atomic_load_explicit (&incumbent->value, memory_order_acquire);
+}
+
+/*
+ * Recording a tour of length value if it is shorter than the best one.
+ * tour may be NULL, when only the length is known. Returns whether value
+ * became the best one.
+ */
+bool
+incumbent_improve (Incumbent *restrict incumbent, const Distance value,
+                   const City *restrict tour)
+{
+    Distance best = incumbent_value (incumbent);
+    unsigned seq;
+
+    // Lowering the value, unless another thread did better
+    do
+        if (value >= best)
+            return false;
+    while (!atomic_compare_exchange_weak_explicit (
+        &incumbent->value, &best, value, memory_order_acq_rel,
+        memory_order_acquire));
+    atomic_fetch_add_explicit (&incumbent->improvements, 1,
+                               memory_order_relaxed);
+
+    //
+    if (!tour)
+        return true;
+
+    // Taking the writer's turn, the sequence number gets odd
+    seq = atomic_load_explicit (&incumbent->seq, memory_order_relaxed);
+    do
+        seq &= ~1u;
+    while (!atomic_compare_exchange_weak_explicit (
+        &incumbent->seq, &seq, seq + 1, memory_order_acquire,
+        memory_order_relaxed));
+    atomic_thread_fence (memory_order_release);
+
+    // Beaten in the meantime, or already written by a better one
+    if (value < atomic_load_explicit (&incumbent->length,
+                                      memory_order_relaxed)
+        && value == incumbent_value (incumbent))
+        {
+            for (size_t i = 0; i < incumbent->n; ++i)
+                atomic_store_explicit (incumbent->tour + i, tour[i],
+                                       memory_order_relaxed);
+            atomic_store_explicit (&incumbent->length, value,
+                                   memory_order_relaxed);
+        }
+
+    // Even again
+    atomic_store_explicit (&incumbent->seq, seq + 2, memory_order_release);
+
+    //
+    return true;
+}
+
+/*
+ * Copying the best tour recorded in tour, returns its length, INFINITY if
+ * no tour was recorded.
+ */
+Distance
+incumbent_tour (Incumbent *restrict incumbent, City *restrict tour)
+{
+    Distance length;
+    unsigned seq;
+
+    //
+    do
+        {
+            // Waiting for the writer
+            do
+                seq = atomic_load_explicit (&incumbent->seq,
+                                            memory_order_acquire);
+            while (seq & 1);
+
+            //
+            length = atomic_load_explicit (&incumbent->length,
+                                           memory_order_relaxed);
+            for (size_t i = 0; i < incumbent->n; ++i)
+                tour[i] = atomic_load_explicit (incumbent->tour + i,
+                                                memory_order_relaxed);
+            atomic_thread_fence (memory_order_acquire);
+        }
+    while (atomic_load_explicit (&incumbent->seq, memory_order_relaxed)
+           != seq);
+
+    //
+    return length;
+}
+
+//
+void
+incumbent_free (Incumbent *restrict incumbent)
+{
+    free ((City *)incumbent->tour);
+
+    // Safety
+    incumbent->tour = NULL;
+    incumbent->n = 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
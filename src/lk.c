@@ -0,0 +1,489 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Lin-Kernighan local search implementation.
+ *
+ * The tour is an array, a move is a sequence of reversals (flips). A step
+ * starts by removing an edge (t1, t2), then repeatedly adds an edge
+ * (t2, t3) towards a candidate of t2 and removes (t4, t3), t4 being the
+ * predecessor of t3, which keeps a tour closed by the edge (t1, t4). The
+ * best closed tour of the sequence is kept.
+ *
+ * The candidates are the 5 alpha-nearest neighbours of every city, from the
+ * tree of the Held-Karp ascent of the root (see prim.c). Local optima are
+ * perturbed by random double bridges, each thread following its own chain
+ * from the given tour.
+ */
+
+#include "lk.h"
+#include "candidates.h"
+#include "heuristic.h"
+#include "prim.h"
+#include "tour.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIST(a, b) graph_distance (graph, a, b)
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+// Position of the successor and the predecessor in the array
+#define NEXT(i) (((i) + 1) % n)
+#define PREV(i) (((i) + n - 1) % n)
+
+// Successor and predecessor of a city in the direction of the step
+#define SUCC(c) (lk->tour[lk->dir ? NEXT (lk->pos[c]) : PREV (lk->pos[c])])
+#define PRED(c) (lk->tour[lk->dir ? PREV (lk->pos[c]) : NEXT (lk->pos[c])])
+
+// Size of the candidate lists
+#define NB_CANDIDATES 5
+
+// Number of flips of a step, and of alternatives for the first t3
+#define MAX_DEPTH 50
+#define BREADTH 5
+
+// Iterations of the Held-Karp ascent of the candidates
+#define ASCENT 100
+
+// Minimal gain of a move, against rounding loops
+#define EPSILON 1e-9
+
+// Per-thread state of the search
+typedef struct
+{
+    /*
+     * tour:  cities in the order of the tour
+     * pos:   position of every city in tour
+     * tmp:   scratch tour
+     * dir:   direction of the tour followed by the current step
+     */
+    const Graph *restrict graph;
+    const Candidates *restrict candidates;
+    City *restrict tour, *restrict pos, *restrict tmp;
+    bool dir;
+
+    // Flips of the current step, as pairs of cities
+    City *restrict flips;
+    size_t nb_flips;
+
+    // Cities to look at, in a circular queue
+    City *restrict queue;
+    bool *restrict queued;
+    size_t head, size;
+
+    //
+    unsigned seed;
+} Lk;
+
+//
+static void
+lk_push (Lk *restrict lk, const City city)
+{
+    const size_t n = lk->graph->n;
+
+    //
+    if (lk->queued[city])
+        return;
+    lk->queue[(lk->head + lk->size++) % n] = city;
+    lk->queued[city] = true;
+}
+
+/*
+ * Reversing the path from a to b, in the direction of the step.
+ * The rest of the tour is reversed instead if it is shorter, which
+ * reverses the direction.
+ */
+static void
+lk_flip (Lk *restrict lk, const City a, const City b)
+{
+    const size_t n = lk->graph->n;
+    City *restrict tour = lk->tour, *restrict pos = lk->pos;
+    size_t i = lk->dir ? pos[a] : pos[b], j = lk->dir ? pos[b] : pos[a];
+    size_t length = (j + n - i) % n + 1;
+
+    //
+    if (2 * length > n)
+        {
+            const size_t start = NEXT (j);
+
+            j = PREV (i);
+            i = start;
+            length = n - length;
+            lk->dir = !lk->dir;
+        }
+
+    //
+    for (size_t k = 0; k < length / 2; ++k)
+        {
+            const size_t x = (i + k) % n, y = (j + n - k) % n;
+            const City tmp = tour[x];
+
+            tour[x] = tour[y];
+            tour[y] = tmp;
+            pos[tour[x]] = x;
+            pos[tour[y]] = y;
+        }
+
+    //
+    lk->flips[2 * lk->nb_flips] = a;
+    lk->flips[2 * lk->nb_flips + 1] = b;
+    lk->nb_flips++;
+}
+
+// Undoing the last flips, down to keep of them
+static void
+lk_undo (Lk *restrict lk, const size_t keep)
+{
+    while (lk->nb_flips > keep)
+        {
+            const size_t last = --lk->nb_flips;
+
+            lk_flip (lk, lk->flips[2 * last + 1], lk->flips[2 * last]);
+            lk->nb_flips--;
+        }
+}
+
+/*
+ * Best t3 for t2, the gain without the closing edge being gain: the one
+ * maximising gain - d(t2, t3) + d(t4, t3), with a positive partial gain.
+ * skip is the number of better choices to ignore.
+ */
+static City
+lk_choose (Lk *restrict lk, const City t1, const City t2,
+           const Distance gain, const size_t skip, const unsigned *stamp,
+           const unsigned step)
+{
+    const Graph *restrict graph = lk->graph;
+    const size_t n = graph->n;
+    City best[BREADTH];
+    Distance value[BREADTH];
+    size_t count = 0;
+
+    //
+    for (size_t k = lk->candidates->start[t2];
+         k < lk->candidates->start[t2 + 1]; ++k)
+        {
+            const City t3 = lk->candidates->list[k], t4 = PRED (t3);
+            const Distance partial = gain - DIST (t2, t3);
+            Distance v;
+            size_t i;
+
+            //
+            if (partial <= EPSILON)
+                continue;
+            if (t3 == t1 || t3 == t2 || t3 == SUCC (t2) || t4 == t1
+                || stamp[t3] == step)
+                continue;
+
+            // Sorted insertion, keeping skip + 1 choices
+            v = partial + DIST (t4, t3);
+            i = MIN (count, skip);
+            if (count > skip && value[skip] >= v)
+                continue;
+            for (; i && value[i - 1] < v; --i)
+                best[i] = best[i - 1], value[i] = value[i - 1];
+            best[i] = t3;
+            value[i] = v;
+            count += count <= skip;
+        }
+
+    //
+    return count > skip ? best[skip] : -1;
+}
+
+/*
+ * Lin-Kernighan step from t1, in both directions.
+ * Returns the gain of the applied move, 0 if the tour did not change.
+ */
+static Distance
+lk_step (Lk *restrict lk, const City t1, unsigned *restrict stamp,
+         unsigned *restrict step)
+{
+    const Graph *restrict graph = lk->graph;
+    const size_t n = graph->n;
+
+    //
+    for (int dir = 0; dir < 2; ++dir)
+        for (size_t alternative = 0; alternative < BREADTH; ++alternative)
+            {
+                Distance gain, best_gain = 0;
+                size_t best_flips = 0;
+                City t2, t3;
+
+                //
+                lk->dir = dir;
+                lk->nb_flips = 0;
+                t2 = SUCC (t1);
+                gain = DIST (t1, t2);
+                ++*step;
+
+                //
+                t3 = lk_choose (lk, t1, t2, gain, alternative, stamp, *step);
+                if (t3 < 0)
+                    break;
+
+                // Going deeper, greedily
+                for (size_t depth = 0; t3 >= 0 && depth < MAX_DEPTH; ++depth)
+                    {
+                        const City t4 = PRED (t3);
+
+                        // t1, t4, ..., t2, t3 from t1, t2, ..., t4, t3
+                        gain += DIST (t4, t3) - DIST (t2, t3);
+                        lk_flip (lk, t2, t4);
+                        stamp[t3] = *step;
+
+                        // Closing the tour
+                        if (gain - DIST (t4, t1) > best_gain + EPSILON)
+                            {
+                                best_gain = gain - DIST (t4, t1);
+                                best_flips = lk->nb_flips;
+                            }
+
+                        //
+                        t2 = t4;
+                        t3 = lk_choose (lk, t1, t2, gain, 0, stamp, *step);
+                    }
+
+                // Keeping the best tour of the sequence
+                lk_undo (lk, best_flips);
+                if (best_flips)
+                    {
+                        lk_push (lk, t1);
+                        for (size_t i = 0; i < 2 * best_flips; ++i)
+                            {
+                                lk_push (lk, lk->flips[i]);
+                                lk_push (lk, SUCC (lk->flips[i]));
+                                lk_push (lk, PRED (lk->flips[i]));
+                            }
+                        return best_gain;
+                    }
+            }
+
+    //
+    return 0;
+}
+
+// Local search until no city in the queue can be improved
+static void
+lk_optimize (Lk *restrict lk, unsigned *restrict stamp,
+             unsigned *restrict step)
+{
+    const size_t n = lk->graph->n;
+
+    for (;;)
+        {
+            while (lk->size)
+                {
+                    const City t1 = lk->queue[lk->head];
+
+                    lk->head = NEXT (lk->head);
+                    lk->size--;
+                    lk->queued[t1] = false;
+
+                    //
+                    while (lk_step (lk, t1, stamp, step) > 0)
+                        ;
+                }
+
+            // Or-opt moves are not sequential, LK may miss some
+            if (!heuristic_oropt (lk->graph, lk->candidates, lk->tour,
+                                  lk->pos, lk->tmp))
+                break;
+
+            // Looking at every city again
+            memcpy (lk->queue, lk->tour, n * sizeof (City));
+            memset (lk->queued, true, n * sizeof (bool));
+            lk->head = 0;
+            lk->size = n;
+        }
+}
+
+//
+static inline size_t
+lk_random (Lk *restrict lk, const size_t max)
+{
+    unsigned x = lk->seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    lk->seed = x;
+
+    return x % max;
+}
+
+/*
+ * Double bridge: the tour A B C D becomes A C B D, the cut points being
+ * random. This move cannot be undone by a few flips.
+ */
+static void
+lk_kick (Lk *restrict lk)
+{
+    const size_t n = lk->graph->n;
+    size_t cut[3], m = 0;
+
+    //
+    for (int i = 0; i < 3; ++i)
+        cut[i] = 1 + lk_random (lk, n - 1);
+    for (int i = 0; i < 3; ++i)
+        for (int j = i + 1; j < 3; ++j)
+            if (cut[j] < cut[i])
+                {
+                    const size_t tmp = cut[i];
+
+                    cut[i] = cut[j];
+                    cut[j] = tmp;
+                }
+
+    //
+    for (size_t k = 0; k < cut[0]; ++k)
+        lk->tmp[m++] = lk->tour[k];
+    for (size_t k = cut[1]; k < cut[2]; ++k)
+        lk->tmp[m++] = lk->tour[k];
+    for (size_t k = cut[0]; k < cut[1]; ++k)
+        lk->tmp[m++] = lk->tour[k];
+    for (size_t k = cut[2]; k < n; ++k)
+        lk->tmp[m++] = lk->tour[k];
+
+    //
+    memcpy (lk->tour, lk->tmp, n * sizeof (City));
+    for (size_t k = 0; k < n; ++k)
+        lk->pos[lk->tour[k]] = k;
+
+    // Looking around the new edges
+    for (int i = 0; i < 3; ++i)
+        {
+            lk_push (lk, lk->tour[cut[i] % n]);
+            lk_push (lk, lk->tour[cut[i] - 1]);
+        }
+    lk_push (lk, lk->tour[0]);
+    lk_push (lk, lk->tour[n - 1]);
+}
+
+/*
+ * Improving the given tour. Every thread runs kicks / threads double
+ * bridges from it, and the best tour found is given back, starting
+ * from the city 0.
+ */
+Distance
+lk_tour (const Graph *restrict graph, City *restrict tour, const size_t kicks)
+{
+    const size_t n = graph->n;
+    Distance best = tour_length (graph, tour);
+    Candidates candidates;
+
+    // Too small to flip anything
+    if (n < 8)
+        return best;
+
+    // Alpha-nearness candidates, from the tree of the root
+    {
+        Pwork pwork = pwork_create (n);
+        Distance *restrict pi = calloc (n, sizeof (Distance));
+        City *restrict reached = calloc (n, sizeof (City));
+        City *restrict degree = malloc (n * sizeof (City));
+        City *restrict tree = malloc (n * sizeof (City));
+
+        //
+        if (!pi || !reached || !degree || !tree)
+            perror ("malloc"), exit (254);
+
+        //
+        prim_bound_tree (&pwork, graph, reached, pi, degree, tree, best,
+                         ASCENT);
+        candidates
+            = candidates_alpha (graph, pi, tree, MIN (n - 1, NB_CANDIDATES));
+
+        //
+        pwork_free (&pwork);
+        free (pi);
+        free (reached);
+        free (degree);
+        free (tree);
+    }
+
+#pragma omp parallel
+    {
+        const int thread = omp_get_thread_num (),
+                  threads = omp_get_num_threads ();
+        Lk lk = { .graph = graph,
+                  .candidates = &candidates,
+                  .tour = malloc (n * sizeof (City)),
+                  .pos = malloc (n * sizeof (City)),
+                  .tmp = malloc (n * sizeof (City)),
+                  .flips = malloc (2 * MAX_DEPTH * sizeof (City)),
+                  .queue = malloc (n * sizeof (City)),
+                  .queued = malloc (n * sizeof (bool)),
+                  .seed = 2 * thread + 1 };
+        City *restrict saved = malloc (n * sizeof (City));
+        unsigned *restrict stamp = calloc (n, sizeof (unsigned));
+        unsigned step = 0;
+        Distance length;
+
+        //
+        if (!lk.tour || !lk.pos || !lk.tmp || !lk.flips || !lk.queue
+            || !lk.queued || !saved || !stamp)
+            perror ("malloc"), exit (254);
+
+        // Local optimum of the given tour
+        memcpy (lk.tour, tour, n * sizeof (City));
+        memcpy (lk.queue, tour, n * sizeof (City));
+        memset (lk.queued, true, n * sizeof (bool));
+        lk.size = n;
+        for (size_t i = 0; i < n; ++i)
+            lk.pos[tour[i]] = i;
+        lk_optimize (&lk, stamp, &step);
+        length = tour_length (graph, lk.tour);
+
+        // Chained Lin-Kernighan
+        for (size_t kick = thread; kick < kicks; kick += threads)
+            {
+                Distance next;
+
+                //
+                memcpy (saved, lk.tour, n * sizeof (City));
+                lk_kick (&lk);
+                lk_optimize (&lk, stamp, &step);
+
+                // Going back to the previous tour if not better
+                next = tour_length (graph, lk.tour);
+                if (next + EPSILON < length)
+                    length = next;
+                else
+                    {
+                        memcpy (lk.tour, saved, n * sizeof (City));
+                        for (size_t i = 0; i < n; ++i)
+                            lk.pos[lk.tour[i]] = i;
+                    }
+            }
+
+#pragma omp critical
+        if (length < best)
+            {
+                // Starting from the city 0
+                for (size_t i = 0; i < n; ++i)
+                    tour[i] = lk.tour[(i + lk.pos[0]) % n];
+                best = length;
+            }
+
+        //
+        free (lk.tour);
+        free (lk.pos);
+        free (lk.tmp);
+        free (lk.flips);
+        free (lk.queue);
+        free (lk.queued);
+        free (saved);
+        free (stamp);
+    }
+
+    //
+    candidates_free (&candidates);
+
+    //
+    return best;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
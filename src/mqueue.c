@@ -0,0 +1,227 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Concurrent multi-queue implementation.
+ *
+ * The frontier is split in several 4-ary heaps, each one protected by its
+ * own lock. Pushes go to a random shard, pops take the best of two random
+ * shards. The pop is thus only approximately best-first, but threads almost
+ * never wait on each other.
+ */
+
+#include "mqueue.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Number of random probes before scanning every shard
+#define MAX_PROBES 8
+
+// Small xorshift generator, the state is owned by the calling thread
+static inline size_t
+mqueue_random (const Mqueue *restrict mqueue, unsigned *restrict seed)
+{
+    unsigned x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+
+    return x % mqueue->size;
+}
+
+// Must be called with the shard's lock held
+static inline void
+squeue_sync (Squeue *restrict squeue)
+{
+    const Heap *restrict heap = &squeue->heap;
+
+#pragma omp atomic write
+    squeue->size = heap->size;
+#pragma omp atomic write
+    squeue->top = heap->size ? heap_top (heap) : 0;
+}
+
+//
+Mqueue
+mqueue_create (const size_t size, const size_t capacity)
+{
+    Mqueue mqueue;
+
+    //
+    if (!size)
+        fprintf (stderr, "non positive mqueue size\n"), exit (255);
+
+    //
+    mqueue.size = size;
+    mqueue.queues = aligned_alloc (64, size * sizeof (Squeue));
+    if (!mqueue.queues)
+        perror ("aligned_alloc"), exit (254);
+
+    //
+    for (size_t i = 0; i < size; ++i)
+        {
+            omp_init_lock (&mqueue.queues[i].lock);
+            mqueue.queues[i].heap = heap_create (capacity);
+            mqueue.queues[i].size = 0;
+            mqueue.queues[i].top = 0;
+        }
+
+    //
+    return mqueue;
+}
+
+//
+void
+mqueue_push (Mqueue *restrict mqueue, const Node *restrict node,
+             unsigned *restrict seed)
+{
+    mqueue_push_batch (mqueue, node, 1, seed);
+}
+
+// Pushing count nodes in the same shard, with one lock
+void
+mqueue_push_batch (Mqueue *restrict mqueue, const Node *restrict nodes,
+                   const size_t count, unsigned *restrict seed)
+{
+    Squeue *squeue;
+
+    // Taking the first random shard that is not busy
+    do
+        squeue = mqueue->queues + mqueue_random (mqueue, seed);
+    while (!omp_test_lock (&squeue->lock));
+
+    //
+    for (size_t i = 0; i < count; ++i)
+        heap_push (&squeue->heap, nodes + i);
+    squeue_sync (squeue);
+    omp_unset_lock (&squeue->lock);
+}
+
+/*
+ * Popping the best node among two random shards.
+ * Returns false if every shard was found empty.
+ */
+bool
+mqueue_pop (Mqueue *restrict mqueue, Node *restrict node,
+            unsigned *restrict seed)
+{
+    for (size_t probe = 0; probe < MAX_PROBES + mqueue->size; ++probe)
+        {
+            Squeue *squeue, *other;
+            size_t size, other_size;
+            Distance top, other_top;
+
+            // Random probes, then a linear scan of every shard
+            if (probe < MAX_PROBES)
+                {
+                    squeue = mqueue->queues + mqueue_random (mqueue, seed);
+                    other = mqueue->queues + mqueue_random (mqueue, seed);
+                }
+            else
+                squeue = other = mqueue->queues + probe - MAX_PROBES;
+
+#pragma omp atomic read
+            size = squeue->size;
+#pragma omp atomic read
+            top = squeue->top;
+#pragma omp atomic read
+            other_size = other->size;
+#pragma omp atomic read
+            other_top = other->top;
+
+            // Keeping the best non empty shard
+            if (other_size && (!size || other_top < top))
+                squeue = other, size = other_size;
+            if (!size)
+                continue;
+
+            // Someone else is working on it, trying another one
+            if (!omp_test_lock (&squeue->lock))
+                {
+                    probe -= probe >= MAX_PROBES;
+                    continue;
+                }
+
+            //
+            if (!heap_empty (&squeue->heap))
+                {
+                    *node = heap_pop (&squeue->heap);
+                    squeue_sync (squeue);
+                    omp_unset_lock (&squeue->lock);
+                    return true;
+                }
+            omp_unset_lock (&squeue->lock);
+        }
+
+    //
+    return false;
+}
+
+/*
+ * Dropping the nodes of every shard whose bound reaches bound, drop being
+ * called on each of them. Returns the number of dropped nodes.
+ */
+size_t
+mqueue_prune (Mqueue *restrict mqueue, const Distance bound,
+              void (*drop) (Node *restrict, void *), void *data)
+{
+    size_t dropped = 0;
+
+    //
+    for (size_t i = 0; i < mqueue->size; ++i)
+        {
+            Squeue *squeue = mqueue->queues + i;
+            size_t size;
+
+            // Nothing to drop
+#pragma omp atomic read
+            size = squeue->size;
+            if (!size)
+                continue;
+            omp_set_lock (&squeue->lock);
+            dropped += heap_prune (&squeue->heap, bound, drop, data);
+            squeue_sync (squeue);
+            omp_unset_lock (&squeue->lock);
+        }
+
+    //
+    return dropped;
+}
+
+// Visiting the nodes of every shard, each one locked in turn
+void
+mqueue_each (Mqueue *restrict mqueue,
+             void (*visit) (const Node *restrict, void *), void *data)
+{
+    for (size_t i = 0; i < mqueue->size; ++i)
+        {
+            Squeue *squeue = mqueue->queues + i;
+
+            //
+            omp_set_lock (&squeue->lock);
+            heap_each (&squeue->heap, visit, data);
+            omp_unset_lock (&squeue->lock);
+        }
+}
+
+//
+void
+mqueue_free (Mqueue *restrict mqueue)
+{
+    //
+    for (size_t i = 0; i < mqueue->size; ++i)
+        {
+            omp_destroy_lock (&mqueue->queues[i].lock);
+            heap_free (&mqueue->queues[i].heap);
+        }
+
+    //
+    free (mqueue->queues);
+
+    // Safety
+    mqueue->size = 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
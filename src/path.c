@@ -0,0 +1,102 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Shared partial tours implementation.
+ *
+ * A node only stores the last step of its partial tour. Steps point to
+ * their parent, so that siblings share their common prefix. A step is
+ * reference counted by its children and by the node that holds it.
+ */
+
+#include "path.h"
+#include <string.h>
+
+//
+Step *
+path_create (Pool *restrict pool, const City city)
+{
+    Step *step = pool_get (pool);
+
+    //
+    step->parent = NULL;
+    step->city = city;
+    step->refs = 1;
+
+    //
+    return step;
+}
+
+/*
+ * Extending a path by one city. The caller must hold a reference
+ * on the parent.
+ */
+Step *
+path_extend (Pool *restrict pool, Step *restrict parent, const City city)
+{
+    Step *step = path_create (pool, city);
+
+    //
+    step->parent = parent;
+#pragma omp atomic
+    parent->refs++;
+
+    //
+    return step;
+}
+
+// Dropping a reference, and the steps no longer used
+void
+path_release (Pool *restrict pool, Step *restrict step)
+{
+    while (step)
+        {
+            Step *parent = step->parent;
+            int refs;
+
+#pragma omp atomic capture
+            refs = --step->refs;
+            if (refs)
+                break;
+
+            //
+            pool_put (pool, step);
+            step = parent;
+        }
+}
+
+// Degree of every city on the path, in O(n + depth)
+void
+path_degrees (const Step *restrict step, City *restrict degree,
+              const size_t n)
+{
+    memset (degree, 0, n * sizeof (City));
+
+    //
+    for (; step->parent; step = step->parent)
+        {
+            degree[step->city]++;
+            degree[step->parent->city]++;
+        }
+}
+
+/*
+ * Cities of the path in cities, from the start city, through the parents.
+ * Returns their number.
+ */
+size_t
+path_cities (const Step *restrict step, City *restrict cities)
+{
+    size_t count = 0;
+
+    //
+    for (const Step *s = step; s; s = s->parent)
+        count++;
+    for (size_t i = count; i--; step = step->parent)
+        cities[i] = step->city;
+
+    //
+    return count;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,235 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Renumbering of the cities.
+ *
+ * The input gives the cities in any order, so that the neighbours of a
+ * city, which the search reaches together, are scattered in the rows of
+ * the matrix, the adjacency lists and the arrays indexed by city. The
+ * cities are renumbered so that close cities get close numbers: along a
+ * Hilbert curve when their coordinates are known, along a nearest
+ * neighbour tour otherwise. The search runs on the permuted matrix, and
+ * its tour is mapped back to the input.
+ */
+
+#include "permute.h"
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bits per coordinate of the grid of the Hilbert curve
+#define HILBERT_BITS 16
+
+// Not relying on isinf, see graph.c
+#define EXISTS(d) ((d) < DBL_MAX)
+
+// Position of the cell (x, y) along the curve, in [0, 4^HILBERT_BITS)
+static inline uint64_t
+permute_hilbert_index (uint32_t x, uint32_t y)
+{
+    const uint32_t side = 1u << HILBERT_BITS;
+    uint64_t index = 0;
+
+    //
+    for (uint32_t s = side / 2; s; s /= 2)
+        {
+            const uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+
+            index += (uint64_t)s * s * ((3 * rx) ^ ry);
+
+            // Rotating the quadrant, so that the curve is continuous
+            if (!ry)
+                {
+                    const uint32_t t = rx ? side - 1 - x : x;
+
+                    x = rx ? side - 1 - y : y;
+                    y = t;
+                }
+        }
+
+    //
+    return index;
+}
+
+// Keys holding the index along the curve then the city, for qsort
+static int
+permute_compare (const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    //
+    return (x > y) - (x < y);
+}
+
+//
+City *
+permute_hilbert (const Coords *restrict coords)
+{
+    const size_t n = coords->n;
+    const double scale = (1u << HILBERT_BITS) - 1;
+    double min_x = INFINITY, max_x = -INFINITY, min_y = INFINITY,
+           max_y = -INFINITY, width, height;
+    uint64_t *keys = malloc (n * sizeof (uint64_t));
+    City *order = malloc (n * sizeof (City));
+
+    //
+    if (!keys || !order)
+        perror ("malloc"), exit (254);
+
+    // Bounding box
+    for (size_t city = 0; city < n; ++city)
+        {
+            min_x = coords->x[city] < min_x ? coords->x[city] : min_x;
+            max_x = coords->x[city] > max_x ? coords->x[city] : max_x;
+            min_y = coords->y[city] < min_y ? coords->y[city] : min_y;
+            max_y = coords->y[city] > max_y ? coords->y[city] : max_y;
+        }
+    width = max_x > min_x ? max_x - min_x : 1;
+    height = max_y > min_y ? max_y - min_y : 1;
+
+    // The city in the low bits, which breaks the ties
+    for (size_t city = 0; city < n; ++city)
+        {
+            const uint32_t x = (coords->x[city] - min_x) / width * scale,
+                           y = (coords->y[city] - min_y) / height * scale;
+
+            keys[city] = permute_hilbert_index (x, y) << 32 | city;
+        }
+    qsort (keys, n, sizeof (uint64_t), permute_compare);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = (City)(keys[i] & UINT32_MAX);
+
+    //
+    free (keys);
+    return order;
+}
+
+/*
+ * Runs in O(n^2). A city without any edge to the remaining ones is
+ * followed by the first remaining city.
+ */
+City *
+permute_nearest (const Graph *restrict graph)
+{
+    const size_t n = graph->n;
+    City *order = malloc (n * sizeof (City));
+    bool *done = calloc (n, sizeof (bool));
+    Weight *row = malloc (n * sizeof (Weight));
+    size_t first = 0;
+
+    //
+    if (!order || !done || !row)
+        perror ("malloc"), exit (254);
+
+    //
+    order[0] = 0;
+    done[0] = true;
+    for (size_t i = 1; i < n; ++i)
+        {
+            Distance best = INFINITY;
+            City next = -1;
+
+            //
+            graph_row (graph, order[i - 1], row);
+            for (size_t city = 0; city < n; ++city)
+                if (!done[city] && DISTANCE (row[city]) < best)
+                    best = DISTANCE (row[city]), next = city;
+            if (!EXISTS (best))
+                {
+                    while (done[first])
+                        first++;
+                    next = first;
+                }
+            order[i] = next;
+            done[next] = true;
+        }
+
+    //
+    free (done);
+    free (row);
+    return order;
+}
+
+//
+void
+permute_coords (Coords *restrict coords, const City *restrict order)
+{
+    const size_t n = coords->n;
+    double *x = malloc (n * sizeof (double));
+    double *y = malloc (n * sizeof (double));
+
+    //
+    if (!x || !y)
+        perror ("malloc"), exit (254);
+    for (size_t i = 0; i < n; ++i)
+        x[i] = coords->x[order[i]], y[i] = coords->y[order[i]];
+
+    //
+    free (coords->x);
+    free (coords->y);
+    coords->x = x;
+    coords->y = y;
+}
+
+/*
+ * The stored part of the row of a city per iteration (see TILE), gathered
+ * from a row of the input
+ */
+Weight *
+permute_matrix (const Graph *restrict graph, const City *restrict order)
+{
+    const size_t n = graph->n;
+    Weight *permuted = graph_matrix (n);
+
+#pragma omp parallel
+    {
+        Weight *row = malloc (n * sizeof (Weight));
+
+        //
+        if (!row)
+            perror ("malloc"), exit (254);
+
+#pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < n; ++i)
+            {
+                graph_row (graph, order[i], row);
+                for (size_t j = 0; j < n && graph_stored (i, j); ++j)
+                    permuted[graph_index (n, i, j)] = row[order[j]];
+            }
+
+        //
+        free (row);
+    }
+
+    //
+    return permuted;
+}
+
+//
+void
+permute_tour (City *restrict tour, const size_t n, const City *restrict order)
+{
+    City *copy = malloc (n * sizeof (City));
+    size_t start = 0;
+
+    //
+    if (!copy)
+        perror ("malloc"), exit (254);
+    for (size_t i = 0; i < n; ++i)
+        {
+            copy[i] = order[tour[i]];
+            start = copy[i] == 0 ? i : start;
+        }
+
+    // Rotating the cycle
+    for (size_t i = 0; i < n; ++i)
+        tour[i] = copy[(start + i) % n];
+
+    //
+    free (copy);
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -0,0 +1,109 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Fixed-size block allocator implementation
+ */
+
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Size of a slab, header included
+#define SLAB_SIZE (1 << 20)
+
+// Room for the chaining pointer at the head of a slab
+#define SLAB_HEADER sizeof (max_align_t)
+
+//
+Pool
+pool_create (const size_t block)
+{
+    const size_t align = sizeof (max_align_t);
+    Pool pool = { 0 };
+
+    //
+    if (!block)
+        fprintf (stderr, "non positive pool block size\n"), exit (255);
+
+    // A free block must at least hold the free list pointer
+    pool.block = (block + align - 1) / align * align;
+    pool.count = (SLAB_SIZE - SLAB_HEADER) / pool.block;
+    if (!pool.count)
+        pool.count = 1;
+
+    // Forcing the first allocation to create a slab
+    pool.used = pool.count;
+
+    //
+    return pool;
+}
+
+//
+void *
+pool_get (Pool *restrict pool)
+{
+    void *block;
+
+    // Recycling a block if possible
+    if (pool->freelist)
+        {
+            block = pool->freelist;
+            pool->freelist = *(void **)block;
+            pool->gets++;
+            return block;
+        }
+
+    // The last slab is full, asking for a new one
+    if (pool->used == pool->count)
+        {
+            void *slab = malloc (SLAB_HEADER + pool->count * pool->block);
+
+            if (!slab)
+                perror ("malloc"), exit (254);
+
+            *(void **)slab = pool->slab;
+            pool->slab = slab;
+            pool->used = 0;
+            pool->slabs++;
+        }
+
+    //
+    block = (char *)pool->slab + SLAB_HEADER + pool->used * pool->block;
+    pool->used++;
+    pool->gets++;
+
+    //
+    return block;
+}
+
+//
+void
+pool_put (Pool *restrict pool, void *restrict block)
+{
+    *(void **)block = pool->freelist;
+    pool->freelist = block;
+    pool->puts++;
+}
+
+/*
+ * Giving the slabs back to the system.
+ * Every pool sharing blocks must be freed at the same time.
+ */
+void
+pool_free (Pool *restrict pool)
+{
+    while (pool->slab)
+        {
+            void *next = *(void **)pool->slab;
+
+            free (pool->slab);
+            pool->slab = next;
+        }
+
+    // Safety
+    pool->freelist = NULL;
+    pool->used = pool->count;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
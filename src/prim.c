@@ -7,18 +7,183 @@
 
 #include "prim.h"
 #include "prim_heap.h"
+#include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define DIST(a, b) distances[(a)*n + (b)]
+#define DIST(a, b) graph_distance (graph, a, b)
 #define MAX(a, b) (((b) < (a)) ? (a) : (b))
 
+// Initial scale of the subgradient step, halved after PATIENCE iterations
+// without a better bound
+#define LAMBDA 2.0
+#define PATIENCE 3
+
+// Largest number of subtrees a repair reconnects, beyond it Prim is rerun
+#define REPAIR_MAX 16
+
+// Not relying on isinf, see graph.c
+#define EXISTS(d) ((d) < DBL_MAX)
+
+//
+Pwork
+pwork_create (const size_t n)
+{
+    Pwork pwork;
+
+    //
+    pwork.pheap = pheap_create (n);
+    pwork.key = malloc (n * sizeof (Distance));
+    pwork.bias = malloc (n * sizeof (Distance));
+    pwork.prec = malloc (n * sizeof (City));
+    pwork.pi = malloc (n * sizeof (Distance));
+    pwork.near = malloc (n * sizeof (Distance));
+    pwork.label = malloc (n * sizeof (City));
+    pwork.stack = malloc (n * sizeof (City));
+    pwork.row = malloc (n * sizeof (Weight));
+    pwork.relax = prim_relax_select ();
+    if (!pwork.key || !pwork.bias || !pwork.prec || !pwork.pi || !pwork.near
+        || !pwork.label || !pwork.stack || !pwork.row)
+        perror ("malloc"), exit (254);
+
+    //
+    return pwork;
+}
+
+//
+void
+pwork_free (Pwork *restrict pwork)
+{
+    pheap_free (&pwork->pheap);
+    free (pwork->key);
+    free (pwork->bias);
+    free (pwork->prec);
+    free (pwork->pi);
+    free (pwork->near);
+    free (pwork->label);
+    free (pwork->stack);
+    free (pwork->row);
+}
+
+//
+Ptree
+ptree_create (const size_t n)
+{
+    Ptree ptree;
+
+    //
+    ptree.prec = malloc (n * sizeof (City));
+    ptree.children = malloc (n * sizeof (City));
+    ptree.first = malloc ((n + 1) * sizeof (size_t));
+    if (!ptree.prec || !ptree.children || !ptree.first)
+        perror ("malloc"), exit (254);
+
+    //
+    return ptree;
+}
+
 //
+void
+ptree_free (Ptree *restrict ptree)
+{
+    free (ptree->prec);
+    free (ptree->children);
+    free (ptree->first);
+}
+
+/*
+ * Prim on a complete graph, in O(n^2).
+ * The tree grows from the first open city. Every step relaxes the row of
+ * the last added city and looks for the closest city in the same pass,
+ * with the vector kernel of the CPU (see prim_relax.c), which reads the
+ * row from the matrix, or from the coordinates through a row computed
+ * beforehand.
+ * The bias of a city is its penalty while it is out of the tree, and
+ * INFINITY once it is in the tree or if it is not open, so that the whole
+ * row can be walked without any test.
+ */
 static inline Distance
-prim_mst (Pheap *restrict pheap, const Distance *restrict distances,
-          City *restrict degree, size_t n, bool update_degree)
+prim_mst_dense (Pwork *restrict pwork, const Graph *restrict graph,
+                const Distance *restrict pi, City *restrict degree,
+                bool update_degree)
 {
+    const size_t n = graph->n;
+    Distance *restrict key = pwork->key, *restrict bias = pwork->bias;
+    City *restrict prec = pwork->prec;
+    Distance mst_weight = 0;
+    size_t open = 0;
+    City last = -1;
+
+    // Adding the non reached nodes
+    for (size_t city = 0; city < n; ++city)
+        {
+            key[city] = INFINITY;
+            if (degree[city] != 2)
+                {
+                    bias[city] = pi ? pi[city] : 0;
+                    if (!open++)
+                        last = city;
+                }
+            else
+                bias[city] = INFINITY;
+        }
+
+    // All reached
+    if (!open)
+        return 0;
+
+    // Adding the root to the tree
+    bias[last] = INFINITY;
+    prec[last] = -1;
+
+    //
+    for (size_t step = 1; step < open; ++step)
+        {
+            Distance best;
+            City next;
+
+            // Relaxing the edges of the last city, and taking the closest
+            if (graph->coords)
+                coords_row (graph->coords, last, n, pwork->row);
+            next = pwork->relax (graph, last,
+                                 graph->coords ? pwork->row : NULL,
+                                 pi ? pi[last] : 0, bias, key, prec, &best);
+
+            // Disconnected graph
+            if (next < 0)
+                return INFINITY;
+
+            //
+            mst_weight += best;
+            key[next] = bias[next] = INFINITY;
+            last = next;
+
+            // Updating the degrees
+            if (update_degree)
+                {
+                    degree[prec[next]]++;
+                    degree[next]++;
+                }
+        }
+
+    //
+    return mst_weight;
+}
+
+/*
+ * Prim on a sparse graph, with a binary heap, in O(m log n).
+ * Only the finite edges of the adjacency lists, start and adjacent in
+ * the format of Graph, are relaxed.
+ */
+static inline Distance
+prim_mst_heap (Pwork *restrict pwork, const Graph *restrict graph,
+               const size_t *restrict start, const City *restrict adjacent,
+               const Distance *restrict pi, City *restrict degree,
+               bool update_degree)
+{
+    const size_t n = graph->n;
+    Pheap *restrict pheap = &pwork->pheap;
     Distance mst_weight = 0;
     pheap_reset (pheap);
 
@@ -38,7 +203,8 @@ prim_mst (Pheap *restrict pheap, const Distance *restrict distances,
 
     // Adding the root to the tree
     {
-        const Pnode next_node = { .index = 0, .value = 0, .prec = -1 };
+        const Pnode next_node
+            = { .index = pheap->pheap[0].index, .value = 0, .prec = -1 };
 
         pheap_update (pheap, &next_node);
     }
@@ -50,6 +216,7 @@ prim_mst (Pheap *restrict pheap, const Distance *restrict distances,
 
             //
             mst_weight += node.value;
+            pwork->prec[node.index] = node.prec;
 
             // Updating the degrees
             if (update_degree && node.prec != -1)
@@ -63,11 +230,14 @@ prim_mst (Pheap *restrict pheap, const Distance *restrict distances,
              * and updating the value of the pheap, with the
              * min.
              */
-            for (size_t city = 0; city < n; ++city)
+            for (size_t k = start[node.index]; k < start[node.index + 1]; ++k)
                 {
-                    const Pnode next_node = { .index = city,
-                                              .value = DIST (node.index, city),
-                                              .prec = node.index };
+                    const City city = adjacent[k];
+                    const Pnode next_node
+                        = { .index = city,
+                            .value = DIST (node.index, city)
+                                     + (pi ? pi[node.index] + pi[city] : 0),
+                            .prec = node.index };
 
                     pheap_update (pheap, &next_node);
                 }
@@ -77,20 +247,99 @@ prim_mst (Pheap *restrict pheap, const Distance *restrict distances,
     return mst_weight;
 }
 
-//
+/*
+ * Minimum spanning tree on the cities with a degree lower than 2.
+ * If pi is given, the weight of an edge (a, b) is shifted by the
+ * penalties of its ends: d(a, b) + pi[a] + pi[b].
+ */
+static inline Distance
+prim_mst (Pwork *restrict pwork, const Graph *restrict graph,
+          const Distance *restrict pi, City *restrict degree,
+          bool update_degree)
+{
+    if (graph->adjacent)
+        return prim_mst_heap (pwork, graph, graph->start, graph->adjacent, pi,
+                              degree, update_degree);
+    else
+        return prim_mst_dense (pwork, graph, pi, degree, update_degree);
+}
+
+/*
+ * Spanning tree of the near subgraph only. Its weight is never below the
+ * one of the minimum spanning tree, and INFINITY if it is disconnected.
+ */
+static inline Distance
+prim_mst_near (Pwork *restrict pwork, const Graph *restrict graph,
+               const Distance *restrict pi, City *restrict degree)
+{
+    return prim_mst_heap (pwork, graph, graph->near_start, graph->near, pi,
+                          degree, true);
+}
+
+/*
+ * With no city reached, a tour is a spanning tree plus one edge: the
+ * cheapest one from the city root is added, as in a 1-tree. Returns its
+ * penalised cost.
+ */
+static inline Distance
+prim_close (const Graph *restrict graph, const Distance *restrict pi,
+            City *restrict degree, const City root)
+{
+    const size_t n = graph->n;
+    Distance best = INFINITY;
+    City next = -1;
+
+    //
+    for (City city = 0; city < n; ++city)
+        if (city != root && EXISTS (DIST (root, city))
+            && DIST (root, city) + pi[city] < best)
+            {
+                best = DIST (root, city) + pi[city];
+                next = city;
+            }
+
+    // No edge
+    if (next < 0)
+        return INFINITY;
+
+    //
+    degree[root]++;
+    degree[next]++;
+    return best + pi[root];
+}
+
+// Nothing reached yet
+static inline bool
+prim_root (const City *restrict degree, const size_t n)
+{
+    for (size_t city = 0; city < n; ++city)
+        if (degree[city])
+            return false;
+    return true;
+}
+
+/*
+ * Held-Karp ascent, from the tree of weight mst_weight built with the
+ * penalties pi, whose degrees are in degree. The cities of degree _degree
+ * are the ones of the node, the tree may come from another one, as long
+ * as the same cities are open.
+ *
+ * With near lists in graph, the following trees only use these edges, in
+ * O(nk log n) instead of O(n^2). The bound returned is still the one of a
+ * tree of the whole graph: the trees of the near lists only drive the
+ * penalties, and are rebuilt in full before stopping on them.
+ */
 Distance
-prim_bound_1tree_opt (Pheap *restrict pheap,
-                      const Distance *restrict _distances,
-                      const City *restrict _degree, size_t n,
-                      Distance *restrict distances, City *restrict degree)
+prim_bound_ascent (Pwork *restrict pwork, const Graph *restrict graph,
+                   const City *restrict _degree, Distance *restrict pi,
+                   City *restrict degree, Distance mst_weight,
+                   const Distance target, const size_t iterations)
 {
-    const size_t dist_size = n * n * sizeof (Distance);
+    const size_t n = graph->n;
     const size_t deg_size = n * sizeof (City);
-    Distance mst_weight = 0;
-
-    // Copying the distances matrix, and the degree matrix
-    memcpy (distances, _distances, dist_size);
-    memcpy (degree, _degree, deg_size);
+    const bool root = prim_root (_degree, n);
+    Distance *restrict best_pi = pwork->pi;
+    Distance bound = -INFINITY;
 
     /*
      * Getting the best 1tree.
@@ -99,63 +348,374 @@ prim_bound_1tree_opt (Pheap *restrict pheap,
      * and positive weights to nodes with more than 2.
      * We repeat this process multiple times.
      * It should converge to a stable value.
+     *
+     * The weights are kept in pi and applied to the edges on the fly,
+     * an edge (a, b) costing d(a, b) + pi[a] + pi[b]. A city that must
+     * still get k edges contributes k times its weight to the tree, which
+     * is removed from the tree's weight to get a valid bound for any pi.
+     *
+     * The step is Polyak's one, (target - bound) / |degree - 2|^2 scaled
+     * by lambda, lambda being halved when the bound stops improving.
+     * Without target, it decays from the mean edge weight.
      */
     {
-#define MAX_IT 25
-
-        double extra_weight, weight_factor = 1;
+        double weight_factor = 1, lambda = LAMBDA;
+        Distance estimate = -INFINITY, peak = -INFINITY;
+        size_t stalled = 0;
+        bool near = graph->near, exact = true;
 
-        // Getting the degrees on the initial mst
-        mst_weight = prim_mst (pheap, distances, degree, n, true);
+        // No tree, no tour
+        if (!EXISTS (mst_weight))
+            return mst_weight;
 
         // Setting the weight_factor as the mean edge weight
         weight_factor = MAX (weight_factor, mst_weight / n);
 
         // Running prim one updated graph
-        for (size_t i = 0; i < MAX_IT; ++i)
+        for (size_t i = 0;; ++i)
             {
-                extra_weight = 0;
+                Distance extra_weight = 0, current;
+                double norm = 0, step;
 
-                // Add weights
+                // Removing the extra weight
                 for (City city = 0; city < n; ++city)
-                    {
-                        const double sup_weight
-                            = weight_factor * (degree[city] - 2);
+                    if (_degree[city] != 2)
+                        {
+                            extra_weight += (2 - _degree[city]) * pi[city];
+                            norm += (degree[city] - 2) * (degree[city] - 2);
+                        }
+                current = mst_weight - extra_weight;
 
-                        // Updating the cost of the city
-                        for (City j = 0; j < n; ++j)
-                            DIST (city, j) += sup_weight;
-                        for (City j = 0; j < n; ++j)
-                            DIST (j, city) += sup_weight;
+                /*
+                 * A tree of the near subgraph is no lighter than the
+                 * minimum one: it only estimates the bound. Where it would
+                 * stop, the tree is rebuilt on the whole graph, which is
+                 * kept for the rest of the ascent.
+                 */
+                if (!exact
+                    && (current >= target || norm == 0 || i == iterations))
+                    {
+                        memcpy (degree, _degree, deg_size);
+                        mst_weight = prim_mst (pwork, graph, pi, degree, true);
+                        if (root)
+                            mst_weight += prim_close (graph, pi, degree, 0);
+                        near = false;
+                        exact = true;
+                        i--;
+                        continue;
+                    }
 
-                        // Updating the tree extra cost
-                        extra_weight += 2 * sup_weight;
+                // The best bound, or the best estimate
+                if (exact && current > bound)
+                    {
+                        bound = current;
+                        memcpy (best_pi, pi, n * sizeof (Distance));
+                    }
+                else if (!exact && current > estimate)
+                    {
+                        estimate = current;
+                        memcpy (pwork->near, pi, n * sizeof (Distance));
+                    }
+                if (current > peak)
+                    {
+                        peak = current;
+                        stalled = 0;
                     }
+                else if (++stalled == PATIENCE)
+                    {
+                        lambda /= 2;
+                        stalled = 0;
+                    }
+
+                // Pruned, exact, or done
+                if (bound >= target || norm == 0 || i == iterations)
+                    break;
+
+                // Add weights
+                step = EXISTS (target) ? lambda * (target - current) / norm
+                                       : weight_factor;
+                for (City city = 0; city < n; ++city)
+                    if (_degree[city] != 2)
+                        pi[city] += step * (degree[city] - 2);
 
                 // Getting the weight
                 memcpy (degree, _degree, deg_size);
-                mst_weight = prim_mst (pheap, distances, degree, n, true);
+                mst_weight = near ? prim_mst_near (pwork, graph, pi, degree)
+                                  : prim_mst (pwork, graph, pi, degree, true);
+                if (root)
+                    mst_weight += prim_close (graph, pi, degree, 0);
+                exact = !near;
                 weight_factor *= 0.9;
             }
 
-        // Removing the extra weight
-        mst_weight += extra_weight;
+        // The penalties of the best estimate, on the whole graph
+        if (estimate > bound)
+            {
+                Distance extra_weight = 0;
+
+                //
+                memcpy (degree, _degree, deg_size);
+                mst_weight
+                    = prim_mst (pwork, graph, pwork->near, degree, true);
+                if (root)
+                    mst_weight += prim_close (graph, pwork->near, degree, 0);
+                for (City city = 0; city < n; ++city)
+                    if (_degree[city] != 2)
+                        extra_weight
+                            += (2 - _degree[city]) * pwork->near[city];
+                if (mst_weight - extra_weight > bound)
+                    {
+                        bound = mst_weight - extra_weight;
+                        memcpy (best_pi, pwork->near, n * sizeof (Distance));
+                    }
+            }
     }
 
+    //
+    memcpy (pi, best_pi, n * sizeof (Distance));
+    return bound;
+}
+
+/*
+ * Held-Karp bound of the cities with a degree lower than 2.
+ * pi holds the starting penalties, the ones of the parent node for
+ * instance, and gets the penalties of the best bound. The ascent stops
+ * early once the bound reaches target, as the node is pruned anyway, or
+ * once the tree has the degrees of a tour, as the bound is then exact.
+ */
+Distance
+prim_bound_1tree_opt (Pwork *restrict pwork, const Graph *restrict graph,
+                      const City *restrict _degree, Distance *restrict pi,
+                      City *restrict degree, const Distance target,
+                      const size_t iterations)
+{
+    const size_t n = graph->n;
+    Distance mst_weight;
+
+    // Getting the degrees on the initial tree
+    memcpy (degree, _degree, n * sizeof (City));
+    mst_weight = prim_mst (pwork, graph, pi, degree, true);
+    if (prim_root (_degree, n))
+        mst_weight += prim_close (graph, pi, degree, 0);
+
+    //
+    return prim_bound_ascent (pwork, graph, _degree, pi, degree, mst_weight,
+                              target, iterations);
+}
+
+/*
+ * Tree of the open cities of a node, with its penalties pi, from which
+ * the bounds of its children are repaired. reached is the degree of the
+ * cities in the node, degree a scratch array.
+ */
+void
+prim_tree (Pwork *restrict pwork, const Graph *restrict graph,
+           const City *restrict reached, const Distance *restrict pi,
+           City *restrict degree, Ptree *restrict ptree)
+{
+    const size_t n = graph->n;
+    size_t *restrict first = ptree->first;
+
+    //
+    memcpy (degree, reached, n * sizeof (City));
+    ptree->weight = prim_mst (pwork, graph, pi, degree, true);
+    for (size_t city = 0; city < n; ++city)
+        ptree->prec[city] = reached[city] != 2 ? pwork->prec[city] : -1;
+
+    // Children of every city, in CSR format
+    memset (first, 0, (n + 1) * sizeof (size_t));
+    for (size_t city = 0; city < n; ++city)
+        if (ptree->prec[city] >= 0)
+            first[ptree->prec[city] + 1]++;
+    for (size_t city = 0; city < n; ++city)
+        first[city + 1] += first[city];
+    for (size_t city = 0; city < n; ++city)
+        if (ptree->prec[city] >= 0)
+            ptree->children[first[ptree->prec[city]]++] = city;
+
+    // Shifted by the filling
+    memmove (first + 1, first, n * sizeof (size_t));
+    first[0] = 0;
+}
+
+/*
+ * First tree of the children of the node of ptree, before any ascent, with
+ * its penalties pi. A child only differs by its new city, so they all share
+ * it while the new city stays open. reached is the degree of the cities
+ * once the position of the node is left: removed, the position, got a
+ * degree of 2 (or -1 if it did not, for the first node). The subtrees of
+ * ptree without removed are joined back by the cheapest edges between
+ * them, taken from the lists edges. This is O(n + m) instead of O(n^2),
+ * an MST keeping its edges when a vertex is removed, the edges of a dense
+ * graph being all walked. Returns the penalised
+ * weight of the tree, whose degrees are in degree.
+ */
+Distance
+prim_first_tree (Pwork *restrict pwork, const Graph *restrict graph,
+                 const Candidates *restrict edges,
+                 const Ptree *restrict ptree, const City removed,
+                 const City *restrict _degree, const Distance *restrict pi,
+                 City *restrict degree)
+{
+    const size_t n = graph->n;
+    City *restrict label = pwork->label, *restrict stack = pwork->stack;
+    City ends[REPAIR_MAX][REPAIR_MAX][2];
+    Distance best[REPAIR_MAX][REPAIR_MAX], key[REPAIR_MAX];
+    City from[REPAIR_MAX], neighbours[REPAIR_MAX];
+    Distance mst_weight;
+    bool in[REPAIR_MAX];
+    size_t k = 0;
+
+// Penalised cost of an edge
+#define COST(a, b) (DIST (a, b) + pi[a] + pi[b])
+
+    // Nothing to repair, or too much: a new tree
+    if (removed >= 0)
+        k = (ptree->prec[removed] >= 0) + ptree->first[removed + 1]
+            - ptree->first[removed];
+    if (removed < 0 || k > REPAIR_MAX)
+        {
+            memcpy (degree, _degree, n * sizeof (City));
+            mst_weight = prim_mst (pwork, graph, pi, degree, true);
+            if (prim_root (_degree, n))
+                mst_weight += prim_close (graph, pi, degree, 0);
+            return mst_weight;
+        }
+
+    // Neighbours of removed in the tree
+    k = 0;
+    mst_weight = ptree->weight;
+    if (ptree->prec[removed] >= 0)
+        neighbours[k++] = ptree->prec[removed];
+    for (size_t i = ptree->first[removed]; i < ptree->first[removed + 1]; ++i)
+        neighbours[k++] = ptree->children[i];
+
+    // Labelling the subtrees, and the degrees of their edges
+    memcpy (degree, _degree, n * sizeof (City));
+    for (size_t city = 0; city < n; ++city)
+        label[city] = -1;
+    for (size_t i = 0; i < k; ++i)
+        {
+            size_t top = 0;
+
+            // Its weight when the tree was built, even if removed since
+            mst_weight -= graph_weight (graph, removed, neighbours[i],
+                                        graph_index (n, removed,
+                                                     neighbours[i]))
+                          + pi[removed] + pi[neighbours[i]];
+            label[neighbours[i]] = i;
+            stack[top++] = neighbours[i];
+            while (top)
+                {
+                    const City a = stack[--top];
+
+#define VISIT(c)                                                              \
+    if ((c) != removed && label[c] < 0)                                       \
+        {                                                                     \
+            label[c] = i;                                                     \
+            degree[a]++;                                                      \
+            degree[c]++;                                                      \
+            stack[top++] = (c);                                               \
+        }
+                    if (ptree->prec[a] >= 0)
+                        VISIT (ptree->prec[a]);
+                    for (size_t j = ptree->first[a]; j < ptree->first[a + 1];
+                         ++j)
+                        VISIT (ptree->children[j]);
+#undef VISIT
+                }
+        }
+
+    // Cheapest edge between every two subtrees
+    for (size_t i = 0; i < k; ++i)
+        for (size_t j = 0; j < k; ++j)
+            best[i][j] = INFINITY;
+    for (size_t a = 0; a < n; ++a)
+        if (label[a] >= 0)
+            for (size_t e = 0; e < candidates_count (edges, a); ++e)
+                {
+                    const City b = candidates_get (edges, a, e);
+
+                    //
+                    if (label[b] >= 0 && label[b] != label[a]
+                        && COST (a, b) < best[label[a]][label[b]])
+                        {
+                            best[label[a]][label[b]] = COST (a, b);
+                            ends[label[a]][label[b]][0] = a;
+                            ends[label[a]][label[b]][1] = b;
+                        }
+                }
+
+    // Prim on the subtrees
+    for (size_t i = 0; i < k; ++i)
+        {
+            key[i] = best[0][i];
+            from[i] = 0;
+            in[i] = !i;
+        }
+    for (size_t step = 1; step < k; ++step)
+        {
+            size_t next = 0;
+
+            //
+            for (size_t i = 1; i < k; ++i)
+                if (!in[i] && (!next || key[i] < key[next]))
+                    next = i;
+
+            // Disconnected
+            if (!EXISTS (key[next]))
+                return INFINITY;
+
+            //
+            mst_weight += key[next];
+            degree[ends[from[next]][next][0]]++;
+            degree[ends[from[next]][next][1]]++;
+            in[next] = true;
+            for (size_t i = 1; i < k; ++i)
+                if (!in[i] && best[next][i] < key[i])
+                    {
+                        key[i] = best[next][i];
+                        from[i] = next;
+                    }
+        }
+#undef COST
+
     //
     return mst_weight;
 }
 
+/*
+ * Same as prim_bound_1tree_opt, also giving the tree built with the final
+ * penalties in tree, as the parent of every open city (-1 for the root).
+ */
+Distance
+prim_bound_tree (Pwork *restrict pwork, const Graph *restrict graph,
+                 const City *restrict reached, Distance *restrict pi,
+                 City *restrict degree, City *restrict tree,
+                 const Distance target, const size_t iterations)
+{
+    const Distance bound = prim_bound_1tree_opt (pwork, graph, reached, pi,
+                                                 degree, target, iterations);
+
+    //
+    memcpy (degree, reached, graph->n * sizeof (City));
+    prim_mst (pwork, graph, pi, degree, false);
+    memcpy (tree, pwork->prec, graph->n * sizeof (City));
+
+    //
+    return bound;
+}
+
 //
 Distance
-prim_bound_mst (Pheap *restrict pheap, const Distance *restrict distances,
-                const City *restrict reached, size_t n)
+prim_bound_mst (Pwork *restrict pwork, const Graph *restrict graph,
+                const City *restrict reached)
 {
     /*
      * Safe cast. The last arguments tells that it
      * should not be updated.
      */
-    return prim_mst (pheap, distances, (City *restrict)reached, n, false);
+    return prim_mst (pwork, graph, NULL, (City *restrict)reached, false);
 }
 
 /* vim: set ts=8 sts=4 sw=4 et : */
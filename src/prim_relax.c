@@ -0,0 +1,415 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Relax-and-argmin kernels of the dense Prim.
+ *
+ * The vector kernels are compiled with target attributes, whatever the
+ * -march of the build, and picked at runtime. One binary thus runs the
+ * best kernel of every machine.
+ *
+ * They read the row of a city from the matrix (see TILE) without copying
+ * it, by TILE contiguous weights, a vector, but above the diagonal of a
+ * triangle, where they are a column of a tile, gathered. The bits of their
+ * removed edges are in a word, a mask of the lanes. The lanes of the
+ * vector kernels are these TILE = 8 cities. The rows of the graphs of
+ * coordinates are computed beforehand, and read instead of the matrix,
+ * whose words still give the removed edges.
+ */
+
+#include "prim_relax.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * The bits of the removed edges of the TILE weights at the position i of
+ * the matrix, from its word: a byte, or for a column of a tile the bit of
+ * i in every byte, moved to the last byte by the multiplication.
+ */
+static inline unsigned
+prim_relax_removed (const uint64_t word, const size_t i, const bool column)
+{
+    const size_t shift = i % (TILE * TILE);
+
+    //
+    if (!column)
+        return word >> shift & 0xff;
+    return (word >> shift & 0x0101010101010101) * 0x0102040810204080 >> 56;
+}
+
+/*
+ * Relaxing the cities of a tile one by one, the ones before it being given
+ * by best and next, their smallest key and its city. Returns the new one.
+ */
+static inline City
+prim_relax_tile (const Graph *restrict graph, const City last,
+                 const Weight *restrict row, const size_t tile,
+                 const Distance shift, const Distance *restrict bias,
+                 Distance *restrict key, City *restrict prec,
+                 Distance *restrict best, City next)
+{
+    const size_t city = tile * TILE;
+    const bool column = graph_column (last / TILE, tile);
+    const size_t index = graph_index (graph->n, last, city);
+    const unsigned bits = prim_relax_removed (
+        graph_removed (graph->removed, index), index, column);
+    const Weight *restrict weights
+        = row ? row + city : graph->distances + index;
+    const size_t stride = column && !row ? TILE : 1;
+
+    //
+    for (size_t c = 0; c < TILE && city + c < graph->n; ++c)
+        {
+            const Distance value
+                = (bits >> c & 1 ? INFINITY : DISTANCE (weights[c * stride]))
+                  + shift + bias[city + c];
+
+            if (value < key[city + c])
+                key[city + c] = value, prec[city + c] = last;
+            if (key[city + c] < *best)
+                *best = key[city + c], next = city + c;
+        }
+
+    //
+    return next;
+}
+
+//
+static City
+prim_relax_scalar (const Graph *restrict graph, const City last,
+                   const Weight *restrict row, const Distance shift,
+                   const Distance *restrict bias, Distance *restrict key,
+                   City *restrict prec, Distance *restrict best)
+{
+    City next = -1;
+
+    //
+    *best = INFINITY;
+    for (size_t tile = 0; tile < TILES (graph->n); ++tile)
+        next = prim_relax_tile (graph, last, row, tile, shift, bias, key,
+                                prec, best, next);
+
+    //
+    return next;
+}
+
+#if defined(__x86_64__)
+
+// Reduction of the lanes, keeping the first city on ties
+static inline City
+prim_relax_reduce (const double *restrict min, const double *restrict index,
+                   const size_t lanes, Distance *restrict best)
+{
+    City next = -1;
+
+    //
+    for (size_t lane = 0; lane < lanes; ++lane)
+        if (min[lane] < *best || (min[lane] == *best && index[lane] < next))
+            *best = min[lane], next = index[lane];
+
+    //
+    return next;
+}
+
+/*
+ * Four weights as doubles, see DISTANCE, contiguous or every TILE weights
+ * for a column of a tile
+ */
+__attribute__ ((target ("avx2"))) static inline __m256d
+prim_relax_load4 (const Weight *restrict weights, const bool column)
+{
+    const __m128i stride = _mm_setr_epi32 (0, TILE, 2 * TILE, 3 * TILE);
+#if defined(WEIGHT_INT)
+    const __m256d value = _mm256_cvtepi32_pd (
+        column ? _mm_i32gather_epi32 ((const int *)weights, stride, 4)
+               : _mm_loadu_si128 ((const __m128i *)weights));
+
+    return _mm256_blendv_pd (
+        value, _mm256_set1_pd (INFINITY),
+        _mm256_cmp_pd (value, _mm256_set1_pd (WEIGHT_MISSING), _CMP_EQ_OQ));
+#elif defined(WEIGHT_FLOAT)
+    return _mm256_cvtps_pd (column ? _mm_i32gather_ps (weights, stride, 4)
+                                   : _mm_loadu_ps (weights));
+#else
+    return column ? _mm256_i32gather_pd (weights, stride, 8)
+                  : _mm256_loadu_pd (weights);
+#endif
+}
+
+// Eight weights as doubles
+__attribute__ ((target ("avx512f,avx512vl"))) static inline __m512d
+prim_relax_load8 (const Weight *restrict weights, const bool column)
+{
+    const __m256i stride = _mm256_setr_epi32 (
+        0, TILE, 2 * TILE, 3 * TILE, 4 * TILE, 5 * TILE, 6 * TILE, 7 * TILE);
+#if defined(WEIGHT_INT)
+    const __m512d value = _mm512_cvtepi32_pd (
+        column ? _mm256_i32gather_epi32 ((const int *)weights, stride, 4)
+               : _mm256_loadu_si256 ((const __m256i *)weights));
+
+    return _mm512_mask_mov_pd (
+        value,
+        _mm512_cmp_pd_mask (value, _mm512_set1_pd (WEIGHT_MISSING),
+                            _CMP_EQ_OQ),
+        _mm512_set1_pd (INFINITY));
+#elif defined(WEIGHT_FLOAT)
+    return _mm512_cvtps_pd (column ? _mm256_i32gather_ps (weights, stride, 4)
+                                   : _mm256_loadu_ps (weights));
+#else
+    return column ? _mm512_i32gather_pd (stride, weights, 8)
+                  : _mm512_loadu_pd (weights);
+#endif
+}
+
+/*
+ * Relaxing the four cities from city, half of the TILE weights from
+ * weights, of a column of a tile if so, whose removed edges are given by
+ * bits, and their argmin per lane, vcity being these cities as doubles
+ */
+__attribute__ ((target ("avx2"))) static inline void
+prim_relax_tile4 (const Weight *restrict weights, const bool column,
+                  const unsigned bits, const size_t half,
+                  const size_t city, const __m256d vshift,
+                  const __m128i vlast, const Distance *restrict bias,
+                  Distance *restrict key, City *restrict prec,
+                  __m256d *restrict vmin, __m256d *restrict vnext,
+                  __m256d *restrict vcity)
+{
+    const __m256i low = _mm256_setr_epi32 (0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256i lanes = _mm256_setr_epi64x (1, 2, 4, 8);
+    __m256d weight = prim_relax_load4 (
+        weights + half * 4 * (column ? TILE : 1), column);
+    __m256d value, vkey, update, lower;
+
+    // Removed edges, without a branch, which would be mispredicted
+    weight = _mm256_blendv_pd (
+        weight, _mm256_set1_pd (INFINITY),
+        _mm256_castsi256_pd (_mm256_cmpeq_epi64 (
+            _mm256_and_si256 (_mm256_set1_epi64x (bits >> (half * 4)), lanes),
+            lanes)));
+
+    //
+    value = _mm256_add_pd (_mm256_add_pd (weight, vshift),
+                           _mm256_loadu_pd (bias + city));
+    vkey = _mm256_loadu_pd (key + city);
+    update = _mm256_cmp_pd (value, vkey, _CMP_LT_OQ);
+
+    // Relaxing, the mask is narrowed to 32 bits for prec
+    if (_mm256_movemask_pd (update))
+        {
+            const __m128i mask = _mm256_castsi256_si128 (
+                _mm256_permutevar8x32_epi32 (_mm256_castpd_si256 (update),
+                                             low));
+            __m128i vprec = _mm_loadu_si128 ((const __m128i *)(prec + city));
+
+            vkey = _mm256_blendv_pd (vkey, value, update);
+            vprec = _mm_blendv_epi8 (vprec, vlast, mask);
+            _mm256_storeu_pd (key + city, vkey);
+            _mm_storeu_si128 ((__m128i *)(prec + city), vprec);
+        }
+
+    // Argmin, per lane
+    lower = _mm256_cmp_pd (vkey, *vmin, _CMP_LT_OQ);
+    *vmin = _mm256_blendv_pd (*vmin, vkey, lower);
+    *vnext = _mm256_blendv_pd (*vnext, *vcity, lower);
+    *vcity = _mm256_add_pd (*vcity, _mm256_set1_pd (4));
+}
+
+// Relaxing the eight cities of a tile, see prim_relax_tile4
+__attribute__ ((target ("avx512f,avx512vl"))) static inline void
+prim_relax_tile8 (const Weight *restrict weights, const bool column,
+                  const unsigned bits, const size_t city,
+                  const __m512d vshift, const __m256i vlast,
+                  const Distance *restrict bias, Distance *restrict key,
+                  City *restrict prec, __m512d *restrict vmin,
+                  __m512d *restrict vnext, __m512d *restrict vcity)
+{
+    __m512d weight = prim_relax_load8 (weights, column);
+    __m512d value, vkey;
+    __mmask8 update, lower;
+
+    // Removed edges, without a branch, which would be mispredicted
+    weight = _mm512_mask_mov_pd (weight, bits, _mm512_set1_pd (INFINITY));
+
+    //
+    value = _mm512_add_pd (_mm512_add_pd (weight, vshift),
+                           _mm512_loadu_pd (bias + city));
+    vkey = _mm512_loadu_pd (key + city);
+    update = _mm512_cmp_pd_mask (value, vkey, _CMP_LT_OQ);
+
+    // Relaxing
+    if (update)
+        {
+            vkey = _mm512_mask_mov_pd (vkey, update, value);
+            _mm512_storeu_pd (key + city, vkey);
+            _mm256_mask_storeu_epi32 (prec + city, update, vlast);
+        }
+
+    // Argmin, per lane
+    lower = _mm512_cmp_pd_mask (vkey, *vmin, _CMP_LT_OQ);
+    *vmin = _mm512_mask_mov_pd (*vmin, lower, vkey);
+    *vnext = _mm512_mask_mov_pd (*vnext, lower, *vcity);
+    *vcity = _mm512_add_pd (*vcity, _mm512_set1_pd (8));
+}
+
+// A tile in two halves, see prim_relax_tile4
+__attribute__ ((target ("avx2"))) static City
+prim_relax_avx2 (const Graph *restrict graph, const City last,
+                 const Weight *restrict row, const Distance shift,
+                 const Distance *restrict bias, Distance *restrict key,
+                 City *restrict prec, Distance *restrict best)
+{
+    const Weight *restrict distances = graph->distances;
+    const uint64_t *removed = graph->removed;
+    const size_t n = graph->n, own = last / TILE;
+    const size_t full = n / TILE;
+    const __m256d vshift = _mm256_set1_pd (shift);
+    const __m128i vlast = _mm_set1_epi32 (last);
+    __m256d vmin = _mm256_set1_pd (INFINITY), vnext = _mm256_set1_pd (-1);
+    __m256d vcity = _mm256_setr_pd (0, 1, 2, 3);
+    double min[4], cities[4];
+    City next;
+    size_t tile = 0, i = graph_index (n, last, 0);
+
+    // The full TILE weights which follow each other, see MATRIX_STEP
+    for (; tile < full && !graph_column (own, tile); ++tile, i += MATRIX_STEP)
+        {
+            const Weight *restrict weights
+                = row ? row + tile * TILE : distances + i;
+            const unsigned bits
+                = prim_relax_removed (graph_removed (removed, i), i, false);
+
+            for (size_t half = 0; half < 2; ++half)
+                prim_relax_tile4 (weights, false, bits, half,
+                                  tile * TILE + half * 4, vshift, vlast, bias,
+                                  key, prec, &vmin, &vnext, &vcity);
+        }
+
+    // The columns right of the diagonal of a triangle
+    for (; tile < full; ++tile)
+        {
+            const size_t j = graph_index (n, last, tile * TILE);
+            const unsigned bits
+                = prim_relax_removed (graph_removed (removed, j), j, true);
+
+            for (size_t half = 0; half < 2; ++half)
+                prim_relax_tile4 (row ? row + tile * TILE : distances + j,
+                                  !row, bits, half, tile * TILE + half * 4,
+                                  vshift, vlast, bias, key, prec, &vmin,
+                                  &vnext, &vcity);
+        }
+
+    //
+    _mm256_storeu_pd (min, vmin);
+    _mm256_storeu_pd (cities, vnext);
+    *best = INFINITY;
+    next = prim_relax_reduce (min, cities, 4, best);
+
+    // The last tile, if it is not full
+    if (tile < TILES (n))
+        next = prim_relax_tile (graph, last, row, tile, shift, bias, key,
+                                prec, best, next);
+    return next;
+}
+
+//
+__attribute__ ((target ("avx512f,avx512vl"))) static City
+prim_relax_avx512 (const Graph *restrict graph, const City last,
+                   const Weight *restrict row, const Distance shift,
+                   const Distance *restrict bias, Distance *restrict key,
+                   City *restrict prec, Distance *restrict best)
+{
+    const Weight *restrict distances = graph->distances;
+    const uint64_t *removed = graph->removed;
+    const size_t n = graph->n, own = last / TILE;
+    const size_t full = n / TILE;
+    const __m512d vshift = _mm512_set1_pd (shift);
+    const __m256i vlast = _mm256_set1_epi32 (last);
+    __m512d vmin = _mm512_set1_pd (INFINITY), vnext = _mm512_set1_pd (-1);
+    __m512d vcity = _mm512_setr_pd (0, 1, 2, 3, 4, 5, 6, 7);
+    double min[8], cities[8];
+    City next;
+    size_t tile = 0, i = graph_index (n, last, 0);
+
+    // The full TILE weights which follow each other, see MATRIX_STEP
+    for (; tile < full && !graph_column (own, tile); ++tile, i += MATRIX_STEP)
+        prim_relax_tile8 (
+            row ? row + tile * TILE : distances + i, false,
+            prim_relax_removed (graph_removed (removed, i), i, false),
+            tile * TILE, vshift, vlast, bias, key, prec, &vmin, &vnext,
+            &vcity);
+
+    // The columns right of the diagonal of a triangle
+    for (; tile < full; ++tile)
+        {
+            const size_t j = graph_index (n, last, tile * TILE);
+
+            prim_relax_tile8 (
+                row ? row + tile * TILE : distances + j, !row,
+                prim_relax_removed (graph_removed (removed, j), j, true),
+                tile * TILE, vshift, vlast, bias, key, prec, &vmin, &vnext,
+                &vcity);
+        }
+
+    //
+    _mm512_storeu_pd (min, vmin);
+    _mm512_storeu_pd (cities, vnext);
+    *best = INFINITY;
+    next = prim_relax_reduce (min, cities, 8, best);
+
+    // The last tile, if it is not full
+    if (tile < TILES (n))
+        next = prim_relax_tile (graph, last, row, tile, shift, bias, key,
+                                prec, best, next);
+    return next;
+}
+
+#endif /* __x86_64__ */
+
+/*
+ * The TSP_RELAX environment variable (scalar, avx2 or avx512) forces
+ * a kernel, for benchmarks.
+ */
+Prelax
+prim_relax_select (void)
+{
+    const char *force = getenv ("TSP_RELAX");
+
+    //
+    if (force && !strcmp (force, "scalar"))
+        return prim_relax_scalar;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init ();
+    if ((!force || !strcmp (force, "avx512"))
+        && __builtin_cpu_supports ("avx512f")
+        && __builtin_cpu_supports ("avx512vl"))
+        return prim_relax_avx512;
+    if (__builtin_cpu_supports ("avx2"))
+        return prim_relax_avx2;
+#endif
+
+    //
+    return prim_relax_scalar;
+}
+
+//
+const char *
+prim_relax_name (const Prelax relax)
+{
+#if defined(__x86_64__)
+    if (relax == prim_relax_avx512)
+        return "avx512";
+    if (relax == prim_relax_avx2)
+        return "avx2";
+#endif
+
+    //
+    return "scalar";
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
@@ -2,45 +2,598 @@
  * PEDERSEN Ny Aina
  * license: Unlicense
  *
- * Implementation of a TSP distance matrix reader
+ * Implementation of a TSP distance matrix reader.
+ *
+ * A file is either the text format, the number of cities then the
+ * matrix, the TSPLIB format, which starts with a keyword, or the binary
+ * format of reader.h, told apart by its magic.
+ * A binary file is mapped as the matrix of the solver, without copy nor
+ * parsing: the pages are only read from the disk once touched. Only a
+ * file of another type than the Weight of the build is converted.
  */
 
+#define _GNU_SOURCE // MADV_HUGEPAGE
+
 #include "reader.h"
+#include "graph.h"
+#include "permute.h"
+#include "tsplib.h"
+#include <fcntl.h>
+#include <float.h>
+#include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Whitespace of the text format, as isspace in the C locale, branch-free
+#define SPACE(c) (((c) == ' ') | ((unsigned char)((c) - '\t') <= '\r' - '\t'))
+#define DIGIT(c) ((unsigned char)((c) - '0') <= 9)
 
 //
-Distance *restrict reader (const char *restrict file, size_t *n)
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// Chunks per thread, against the uneven ones
+#define CHUNKS 4
+
+// Longest number handed to strtod
+#define MAX_NUMBER 64
+
+// Not relying on isinf, see graph.c
+#define EXISTS(d) ((d) < DBL_MAX)
+
+// Names and sizes of the types of the binary format, see Rtype
+static const char *reader_names[] = { NULL, "double", "float", "int" };
+static const size_t reader_sizes[]
+    = { 0, sizeof (double), sizeof (float), sizeof (int32_t) };
+
+// Powers of ten exact in a double
+static const double reader_pow10[]
+    = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/*
+ * Parsing the number at *p, which ends before end, and moving *p past it.
+ * Returns false if it is not a number followed by a whitespace or end.
+ *
+ * Up to 19 digits and an exponent of 22, the value is the exact integer
+ * of the digits times or divided by an exact power of ten, which is
+ * correctly rounded (Clinger's fast path). Other numbers go to strtod.
+ */
+static inline bool
+reader_number (const char **p, const char *end, Distance *restrict value)
 {
-    Distance *distances = NULL;
-    FILE *f = NULL;
+    const char *s = *p;
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool negative = false, any = false;
 
     //
-    f = fopen (file, "r");
-    if (!f)
-        perror ("fopen"), exit (255);
+    if (s < end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+
+    // Missing edges
+    if (s < end && (*s | 0x20) == 'i' && end - s >= 3
+        && !strncasecmp (s, "inf", 3))
+        {
+            s += 3;
+            if (end - s >= 5 && !strncasecmp (s, "inity", 5))
+                s += 5;
+            *value = negative ? -INFINITY : INFINITY;
+            goto done;
+        }
+
+    // Digits, without the leading zeros
+    for (; s < end && DIGIT (*s); ++s, any = true)
+        {
+            mantissa = mantissa * 10 + (*s - '0');
+            digits += mantissa != 0;
+        }
+    if (s < end && *s == '.')
+        for (++s; s < end && DIGIT (*s); ++s, --exponent, any = true)
+            {
+                mantissa = mantissa * 10 + (*s - '0');
+                digits += mantissa != 0;
+            }
+    if (!any)
+        return false;
+
+    // Exponent, saturated
+    if (s < end && (*s == 'e' || *s == 'E'))
+        {
+            int e = 0, sign = 1;
+
+            //
+            if (++s < end && (*s == '-' || *s == '+'))
+                sign = *s++ == '-' ? -1 : 1;
+            if (s == end || !DIGIT (*s))
+                return false;
+            for (; s < end && DIGIT (*s); ++s)
+                e = e < 10000 ? e * 10 + (*s - '0') : e;
+            exponent += sign * e;
+        }
+
+    //
+    if (digits <= 19 && mantissa <= (uint64_t)1 << 53 && exponent >= -22
+        && exponent <= 22)
+        *value = exponent < 0 ? mantissa / reader_pow10[-exponent]
+                              : mantissa * reader_pow10[exponent];
+    else
+        {
+            char number[MAX_NUMBER];
+
+            //
+            if (s - *p >= MAX_NUMBER)
+                return false;
+            memcpy (number, *p, s - *p);
+            number[s - *p] = '\0';
+            *value = strtod (number, NULL);
+            negative = false;
+        }
+    if (negative)
+        *value = -*value;
+
+done:
+    if (s < end && !SPACE (*s))
+        return false;
+    *p = s;
+    return true;
+}
+
+// Finalizer of splitmix64, whose bits all depend on the ones of x
+static inline uint64_t
+reader_mix (uint64_t x)
+{
+    x = (x ^ x >> 30) * 0xbf58476d1ce4e5b9;
+    x = (x ^ x >> 27) * 0x94d049bb133111eb;
+    return x ^ x >> 31;
+}
+
+/*
+ * Term of the distance weight of (a, b) in a sum over the matrix which is
+ * 0 if it is symmetric, as the terms of (a, b) and (b, a) cancel out: a
+ * hash of the edge and of the weight, negated for a > b, 0 for a = b. An
+ * asymmetric matrix gives 0 with a probability of 2^-64.
+ */
+static inline uint64_t
+reader_mirror (const size_t a, const size_t b, Weight weight)
+{
+    uint64_t bits = 0, hash;
+
+    //
+    if (weight == 0) // -0
+        weight = 0;
+    memcpy (&bits, &weight, sizeof (Weight));
+    hash = reader_mix (reader_mix ((uint64_t)MIN (a, b) << 32 | MAX (a, b))
+                       ^ bits);
+    return a < b ? hash : a > b ? -hash : 0;
+}
+
+// Reporting an error at the position p of the text, and exiting
+static void
+reader_error (const char *restrict file, const char *text, const char *p,
+              const char *restrict message)
+{
+    size_t line = 1, column = 1;
+
+    //
+    for (; text < p; ++text)
+        if (*text == '\n')
+            line++, column = 1;
+        else
+            column++;
+
+    //
+    fprintf (stderr, "%s:%zu:%zu: %s\n", file, line, column, message);
+    exit (255);
+}
+
+/*
+ * Text format. The file is mapped, and the matrix split in chunks at
+ * whitespaces which are parsed in parallel: a first pass counts the
+ * numbers of every chunk, where the second one writes them. Every number
+ * is checked, but the ones above the diagonal of a triangle are not kept
+ * (see TILE), the matrix being symmetric, which is checked on the fly by
+ * a sum of the numbers, see reader_mirror.
+ */
+static Matrix
+reader_text (const char *restrict file, const int fd)
+{
+    Matrix matrix = { 0 };
+    const char *text, *end, *p, *data;
+    const char **bounds, **errors, **messages;
+    size_t *first, chunks, size, n = 0;
+    uint64_t mirror = 0;
+    struct stat st;
+
+    //
+    if (fstat (fd, &st) < 0)
+        perror ("fstat"), exit (255);
+    size = st.st_size;
+    if (!size)
+        fprintf (stderr, "%s: empty file\n", file), exit (255);
+    text = mmap (NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (text == MAP_FAILED)
+        perror ("mmap"), exit (254);
+    madvise ((void *)text, size, MADV_SEQUENTIAL);
+    end = text + size;
 
     // Scanning the header
-    fscanf (f, " %lu", n);
+    for (p = text; p < end && SPACE (*p); ++p)
+        ;
+    data = p;
+    for (; p < end && DIGIT (*p); ++p)
+        n = n * 10 + (*p - '0');
+    if (p == data || !n || (p < end && !SPACE (*p)))
+        reader_error (file, text, data, "expected the number of cities");
+    data = p;
 
     // Memory allocation
-    distances = malloc (*n * *n * sizeof (Distance));
-    if (!distances)
+    matrix.n = n;
+    matrix.distances = graph_matrix (n);
+    chunks = CHUNKS * omp_get_max_threads ();
+    bounds = malloc ((chunks + 1) * sizeof (char *));
+    errors = malloc (chunks * sizeof (char *));
+    messages = malloc (chunks * sizeof (char *));
+    first = malloc ((chunks + 1) * sizeof (size_t));
+    if (!bounds || !errors || !messages || !first)
         perror ("malloc"), exit (254);
 
-    // Scanning the distance matrix
-    for (size_t i = 0; i < *n * *n; ++i)
-        fscanf (f, " %lf", distances + i);
+    // Chunks ending on a whitespace, no number being split
+    for (size_t c = 0; c <= chunks; ++c)
+        {
+            const char *b = data + (end - data) * c / chunks;
+
+            while (c && b < end && !SPACE (*b))
+                b++;
+            bounds[c] = c && b < bounds[c - 1] ? bounds[c - 1] : b;
+        }
+
+#pragma omp parallel
+    {
+        // Counting the numbers, as the starts of words
+#pragma omp for schedule(dynamic, 1)
+        for (size_t c = 0; c < chunks; ++c)
+            {
+                const char *q = bounds[c], *stop = bounds[c + 1];
+                size_t count = q < stop && !SPACE (*q);
+
+                // Independent bytes, which vectorizes
+                for (++q; q < stop; ++q)
+                    count += SPACE (q[-1]) & !SPACE (q[0]);
+                first[c + 1] = count;
+                errors[c] = NULL;
+            }
+
+        // Where every chunk writes
+#pragma omp single
+        {
+            first[0] = 0;
+            for (size_t c = 0; c < chunks; ++c)
+                first[c + 1] += first[c];
+        }
+
+        // Parsing, the first error of a chunk being kept
+#pragma omp for schedule(dynamic, 1) reduction(+ : mirror)
+        for (size_t c = 0; c < chunks; ++c)
+            {
+                const char *q = bounds[c], *stop = bounds[c + 1];
+                size_t i = first[c], row = i / n, column = i % n;
+
+                while (true)
+                    {
+                        const char *number;
+                        Distance value;
+                        Weight weight;
+
+                        //
+                        while (q < stop && SPACE (*q))
+                            q++;
+                        if (q == stop)
+                            break;
+                        number = q;
+                        if (i == n * n)
+                            messages[c] = "more distances than n^2";
+                        else if (!reader_number (&q, end, &value))
+                            messages[c] = "invalid distance";
+                        else if (!reader_weight (value, &weight))
+                            messages[c] = "distance not exact as " WEIGHT_NAME,
+                            q = number;
+                        else
+                            {
+                                if (graph_stored (row, column))
+                                    matrix.distances[graph_index (n, row,
+                                                                  column)]
+                                        = weight;
+                                mirror += reader_mirror (row, column, weight);
+                                if (++column == n)
+                                    column = 0, row++;
+                                i++;
+                                continue;
+                            }
+                        errors[c] = q;
+                        break;
+                    }
+            }
+    }
+
+    // The first error in the file
+    for (size_t c = 0; c < chunks; ++c)
+        if (errors[c])
+            reader_error (file, text, errors[c], messages[c]);
+    if (first[chunks] < n * n)
+        reader_error (file, text, end, "fewer distances than n^2");
+    if (mirror)
+        fprintf (stderr, "%s: asymmetric matrix\n", file), exit (255);
+
+    // Missing diagonals
+    for (size_t i = 0; i < n; ++i)
+        matrix.distances[graph_index (n, i, i)] = WEIGHT_MISSING;
+
+    //
+    munmap ((void *)text, size);
+    free (bounds);
+    free (errors);
+    free (messages);
+    free (first);
+
+    //
+    return matrix;
+}
+
+// Position of the distance of (a, b) in a matrix of the binary format
+static size_t
+reader_index (const uint32_t flags, const size_t n, const size_t a,
+              const size_t b)
+{
+    const size_t i = a / TILE, j = b / TILE, r = a % TILE, c = b % TILE;
+
+    //
+    if (flags & READER_TILED)
+        return i < j ? graph_tile (j, i) + c * TILE + r
+                     : graph_tile (i, j) + r * TILE + c;
+    return a * (flags & READER_PADDED ? STRIDE (n) : n) + b;
+}
+
+// The value at i of a matrix of the binary format of type
+static inline Distance
+reader_value (const void *restrict values, const Rtype type, const size_t i)
+{
+    if (type == READER_INT32)
+        return ((const int32_t *)values)[i] == INT32_MAX
+                   ? INFINITY
+                   : ((const int32_t *)values)[i];
+    if (type == READER_FLOAT)
+        return ((const float *)values)[i];
+    return ((const double *)values)[i];
+}
+
+/*
+ * Converting a mapped matrix of another type than the Weight of the build,
+ * or of another layout, to the layout of the build, in parallel. Integer
+ * values must stay exact, see reader_weight. A matrix not flagged
+ * symmetric is checked.
+ */
+static void
+reader_convert (const char *restrict file, Matrix *restrict matrix,
+                const void *restrict values, const Rtype type,
+                const uint32_t flags)
+{
+    const size_t n = matrix->n;
+    const bool check = !(flags & READER_SYMMETRIC);
+    bool exact = true, symmetric = true;
+
+    //
+    matrix->distances = graph_matrix (n);
+
+#pragma omp parallel for schedule(dynamic, 64)                                \
+    reduction(&& : exact, symmetric)
+    for (size_t a = 0; a < n; ++a)
+        for (size_t b = 0; b < n && graph_stored (a, b); ++b)
+            {
+                const size_t i = reader_index (flags, n, a, b);
+                const Distance value = reader_value (values, type, i);
+
+                //
+                exact = reader_weight (value, matrix->distances
+                                                  + graph_index (n, a, b))
+                        && exact;
+                if (check && b < a)
+                    symmetric = reader_value (values, type,
+                                              reader_index (flags, n, b, a))
+                                    == value
+                                && symmetric;
+            }
+    if (!exact)
+        fprintf (stderr, "%s: distances of type %s not exact as %s\n", file,
+                 reader_names[type], WEIGHT_NAME),
+            exit (255);
+    if (!symmetric)
+        fprintf (stderr, "%s: asymmetric matrix\n", file), exit (255);
+
+    // The mapping is not needed anymore
+    munmap (matrix->map, matrix->length);
+    matrix->map = NULL;
+}
+
+/*
+ * Binary format, the header being already checked. The matrix is mapped
+ * if it has the layout and the type of the build, and is known symmetric,
+ * and converted otherwise.
+ */
+static Matrix
+reader_map (const char *restrict file, const int fd,
+            const Rheader *restrict header)
+{
+    const uint32_t flags = header->flags;
+    const size_t n = header->n, tiles = TILES (n), stride = STRIDE (n);
+    const size_t values
+        = flags & READER_TILED    ? tiles * (tiles + 1) / 2 * TILE * TILE
+          : flags & READER_PADDED ? stride * stride
+                                  : n * n;
+    Matrix matrix = { .n = n };
+    struct stat st;
+
+    //
+    if (header->type < READER_DOUBLE || header->type > READER_INT32)
+        fprintf (stderr, "%s: unsupported type %u\n", file, header->type),
+            exit (255);
+    if (fstat (fd, &st) < 0)
+        perror ("fstat"), exit (255);
+    if (!header->n || header->offset % READER_ALIGN
+        || (size_t)st.st_size
+               < header->offset + values * reader_sizes[header->type])
+        fprintf (stderr, "%s: truncated or corrupted matrix\n", file),
+            exit (255);
+
+    /*
+     * Private and writable, so that the pages are only copied if the
+     * matrix is ever written to.
+     */
+    matrix.length = st.st_size;
+    matrix.map = mmap (NULL, matrix.length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0);
+    if (matrix.map == MAP_FAILED)
+        perror ("mmap"), exit (254);
+    madvise (matrix.map, matrix.length, MADV_HUGEPAGE);
+    madvise (matrix.map, matrix.length, MADV_WILLNEED);
+
+    //
+    if (header->type == READER_WEIGHT && flags & READER_SYMMETRIC
+        && (flags & (READER_TILED | READER_PADDED)) == READER_LAYOUT)
+        matrix.distances = (Weight *)((char *)matrix.map + header->offset);
+    else
+        reader_convert (file, &matrix, (char *)matrix.map + header->offset,
+                        header->type, flags);
+    return matrix;
+}
 
-    // Adding infinity to diagonals
-    for (size_t i = 0; i < *n; ++i)
-        distances[i * *n + i] = INFINITY;
+/*
+ * With permute, the cities are renumbered for locality: a TSPLIB file of
+ * coordinates does it on its own, along a Hilbert curve, a matrix is
+ * permuted along a nearest neighbour tour.
+ */
+Matrix
+reader (const char *restrict file, const bool permute)
+{
+    Rheader header;
+    Matrix matrix;
+    const char *first = (const char *)&header;
+    ssize_t size;
+    int fd;
 
     //
-    fclose (f);
+    fd = open (file, O_RDONLY);
+    if (fd < 0)
+        perror ("open"), exit (255);
+    size = read (fd, &header, sizeof (header));
+    while (size > 0 && first < (const char *)&header + size && SPACE (*first))
+        first++;
+
+    // The mapping outlives the descriptor
+    if (size == sizeof (header)
+        && !memcmp (header.magic, READER_MAGIC, sizeof (header.magic)))
+        matrix = reader_map (file, fd, &header);
+    else if (size > 0 && first < (const char *)&header + size
+             && ((*first | 0x20) >= 'a' && (*first | 0x20) <= 'z'))
+        matrix = tsplib_read (file, permute);
+    else
+        matrix = reader_text (file, fd);
+    close (fd);
+
+    // The input matrix is not needed anymore
+    if (permute && !matrix.order)
+        {
+            const Graph graph
+                = { .distances = matrix.distances, .n = matrix.n };
+            Weight *permuted;
+
+            //
+            matrix.order = permute_nearest (&graph);
+            permuted = permute_matrix (&graph, matrix.order);
+            if (matrix.map)
+                munmap (matrix.map, matrix.length);
+            else
+                free (matrix.distances);
+            matrix.distances = permuted;
+            matrix.map = NULL;
+        }
 
     //
-    return distances;
+    return matrix;
+}
+
+/*
+ * Storing a distance as a Weight, missing if infinite. Returns false if
+ * the Weight does not hold it exactly while it is an integer, or if it is
+ * not an integer for int weights: an integer instance is solved exactly
+ * in every build, or refused.
+ */
+bool
+reader_weight (const Distance value, Weight *restrict weight)
+{
+    if (!EXISTS (value))
+        return *weight = WEIGHT_MISSING, true;
+
+#if defined(WEIGHT_INT)
+    // INT32_MAX being the missing edges
+    if (!(value > INT32_MIN - 1.0 && value < INT32_MAX))
+        return false;
+    *weight = value;
+    return *weight == value;
+#else
+    *weight = value;
+    return *weight == value || value != rint (value);
+#endif
+}
+
+// Writing the matrix in the binary format, with the type of the build
+void
+reader_write (const char *restrict file, const Weight *restrict distances,
+              const size_t n)
+{
+    Rheader header = { .n = n,
+                       .type = READER_WEIGHT,
+                       .flags = READER_SYMMETRIC | READER_LAYOUT,
+                       .offset = READER_ALIGN };
+    char padding[READER_ALIGN] = { 0 };
+    FILE *f = NULL;
+
+    //
+    memcpy (header.magic, READER_MAGIC, sizeof (header.magic));
+
+    //
+    f = fopen (file, "w");
+    if (!f)
+        perror ("fopen"), exit (255);
+    if (fwrite (&header, sizeof (header), 1, f) != 1
+        || fwrite (padding, READER_ALIGN - sizeof (header), 1, f) != 1
+        || fwrite (distances, sizeof (Weight), MATRIX_SIZE (n), f)
+               != MATRIX_SIZE (n)
+        || fclose (f))
+        perror ("fwrite"), exit (254);
+}
+
+//
+void
+reader_free (Matrix *restrict matrix)
+{
+    if (matrix->map)
+        munmap (matrix->map, matrix->length);
+    else
+        free (matrix->distances);
+    coords_free (&matrix->coords);
+    free (matrix->order);
+
+    // Safety
+    matrix->distances = NULL;
+    matrix->map = NULL;
+    matrix->order = NULL;
+    matrix->n = 0;
 }
 
 /* vim: set ts=8 sts=4 sw=4 et : */
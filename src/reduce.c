@@ -0,0 +1,206 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Reduced cost edge elimination implementation.
+ *
+ * Forcing an edge in the tree of the root raises the Held-Karp bound of
+ * the root by the alpha-nearness of the edge at least (see candidates.c).
+ * So a tour using an edge (a, b) is not shorter than bound + alpha(a, b),
+ * and the edge can be removed from the graph once this is not lower than
+ * the best known tour. Every better tour removes more edges.
+ */
+
+#define _GNU_SOURCE // qsort_r
+
+#include "reduce.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DIST(a, b) graph_distance (reduce->graph, a, b)
+
+// Not relying on isinf, see graph.c
+#define EXISTS(d) ((d) < DBL_MAX)
+
+// Whether the edge at i in the matrix is eliminated, see TILE
+static inline bool
+reduce_eliminated (const Reduce *restrict reduce, const size_t i)
+{
+    uint64_t word;
+
+#pragma omp atomic read
+    word = reduce->eliminated[i / 64];
+    return word >> (i % 64) & 1;
+}
+
+// Setting the bit of the edge at i, returns whether it was not yet set
+static inline bool
+reduce_eliminate (Reduce *restrict reduce, const size_t i)
+{
+    const uint64_t bit = (uint64_t)1 << i % 64;
+    uint64_t old;
+
+#pragma omp atomic capture
+    {
+        old = reduce->eliminated[i / 64];
+        reduce->eliminated[i / 64] |= bit;
+    }
+    return !(old & bit);
+}
+
+/*
+ * The tree is the one of the root, given by the parent of every city,
+ * built with the penalties pi which give the bound.
+ */
+Reduce
+reduce_create (const Graph *restrict graph, const Distance *restrict pi,
+               const City *restrict tree, const Distance bound)
+{
+    const size_t n = graph->n;
+    Reduce reduce = { .graph = graph, .n = n, .bound = bound };
+
+    //
+    reduce.eliminated = calloc (MATRIX_SIZE (n) / 64 + 1, sizeof (uint64_t));
+    if (!reduce.eliminated)
+        perror ("malloc"), exit (254);
+    reduce.alpha = candidates_alpha_create (n, pi, tree);
+
+    //
+    for (size_t a = 0; a < n; ++a)
+        for (size_t b = 0; b < a; ++b)
+            reduce.edges += EXISTS (graph_distance (graph, a, b));
+
+    //
+    return reduce;
+}
+
+/*
+ * Eliminating the edges that cannot be in a tour shorter than best.
+ * Returns the number of edges eliminated by this call.
+ *
+ * The bitset may be read by other threads meanwhile. They either see the
+ * edge or not, and both give valid bounds.
+ */
+size_t
+reduce_edges (Reduce *restrict reduce, const Distance best)
+{
+    const size_t n = reduce->n;
+    Distance *restrict alpha = malloc (n * sizeof (Distance));
+    City *restrict stack = malloc (n * sizeof (City));
+    City *restrict from = malloc (n * sizeof (City));
+    size_t removed = 0;
+
+    //
+    if (!alpha || !stack || !from)
+        perror ("malloc"), exit (254);
+
+    /*
+     * Several threads may eliminate at once, an edge is counted once. Both
+     * of its orientations are set, which share their place outside of the
+     * diagonal tiles of a triangle.
+     */
+    for (size_t a = 0; a < n; ++a)
+        {
+            candidates_alpha_row (reduce->graph, &reduce->alpha, a, alpha,
+                                  stack, from);
+            for (size_t b = 0; b < a; ++b)
+                {
+                    const size_t i = graph_index (n, a, b);
+
+                    //
+                    if (!EXISTS (alpha[b]) || reduce_eliminated (reduce, i)
+                        || reduce->bound + alpha[b] < best)
+                        continue;
+                    removed += reduce_eliminate (reduce, i);
+                    reduce_eliminate (reduce, graph_index (n, b, a));
+                }
+        }
+
+    //
+    free (alpha);
+    free (stack);
+    free (from);
+
+    //
+#pragma omp atomic
+    reduce->removed += removed;
+    return removed;
+}
+
+// Alpha-nearness of the edges of a, for qsort_r
+static int
+reduce_compare (const void *a, const void *b, void *alpha)
+{
+    const Distance x = ((Distance *)alpha)[*(City *)a],
+                   y = ((Distance *)alpha)[*(City *)b];
+
+    //
+    return (x > y) - (x < y);
+}
+
+/*
+ * The neighbours of every city through the remaining edges, by increasing
+ * alpha-nearness, the most promising first.
+ */
+Candidates
+reduce_candidates (const Reduce *restrict reduce)
+{
+    const size_t n = reduce->n;
+    Candidates candidates = { .n = n };
+    Distance *restrict row = malloc (n * sizeof (Distance));
+    City *restrict stack = malloc (n * sizeof (City));
+    City *restrict from = malloc (n * sizeof (City));
+
+    //
+    candidates.start = malloc ((n + 1) * sizeof (size_t));
+    if (!candidates.start || !row || !stack || !from)
+        perror ("malloc"), exit (254);
+
+    // Counting
+    candidates.start[0] = 0;
+    for (size_t a = 0; a < n; ++a)
+        {
+            candidates.start[a + 1] = candidates.start[a];
+            for (size_t b = 0; b < n; ++b)
+                candidates.start[a + 1]
+                    += a != b && EXISTS (DIST (a, b))
+                       && !reduce_eliminated (reduce, graph_index (n, a, b));
+        }
+
+    // Filling
+    candidates.list = malloc ((candidates.start[n] + 1) * sizeof (City));
+    if (!candidates.list)
+        perror ("malloc"), exit (254);
+    for (size_t a = 0, k = 0; a < n; ++a)
+        {
+            candidates_alpha_row (reduce->graph, &reduce->alpha, a, row,
+                                  stack, from);
+            for (size_t b = 0; b < n; ++b)
+                if (a != b && EXISTS (DIST (a, b))
+                    && !reduce_eliminated (reduce, graph_index (n, a, b)))
+                    candidates.list[k++] = b;
+            qsort_r (candidates.list + candidates.start[a],
+                     candidates.start[a + 1] - candidates.start[a],
+                     sizeof (City), reduce_compare, row);
+        }
+    free (row);
+    free (stack);
+    free (from);
+
+    //
+    return candidates;
+}
+
+//
+void
+reduce_free (Reduce *restrict reduce)
+{
+    free (reduce->eliminated);
+    candidates_alpha_free (&reduce->alpha);
+
+    // Safety
+    reduce->eliminated = NULL;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
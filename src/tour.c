@@ -0,0 +1,68 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * Tour utilities implementation
+ */
+
+#include "tour.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DIST(a, b) graph_distance (graph, a, b)
+#define MAX(a, b) (((a) < (b)) ? (b) : (a))
+
+// Length of the cycle going through the n cities of tour
+Distance
+tour_length (const Graph *restrict graph, const City *restrict tour)
+{
+    const size_t n = graph->n;
+    Distance length = 0;
+
+    //
+    for (size_t i = 0; i < n; ++i)
+        length += DIST (tour[i], tour[(i + 1) % n]);
+
+    //
+    return length;
+}
+
+/*
+ * Checking that tour visits every city once, through edges of the graph,
+ * and that its length is length.
+ */
+bool
+tour_verify (const Graph *restrict graph, const City *restrict tour,
+             const Distance length)
+{
+    const size_t n = graph->n;
+    bool *restrict seen = calloc (n, sizeof (bool));
+    bool valid = true;
+
+    //
+    if (!seen)
+        perror ("calloc"), exit (254);
+
+    // A permutation
+    for (size_t i = 0; i < n && valid; ++i)
+        {
+            valid = tour[i] >= 0 && tour[i] < n && !seen[tour[i]];
+            if (valid)
+                seen[tour[i]] = true;
+        }
+
+    // Every edge exists, and the lengths are summed in another order
+    for (size_t i = 0; i < n && valid; ++i)
+        valid = DIST (tour[i], tour[(i + 1) % n]) < DBL_MAX;
+    valid = valid
+            && fabs (tour_length (graph, tour) - length)
+                   <= 1e-9 * MAX (1, fabs (length));
+
+    //
+    free (seen);
+    return valid;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */
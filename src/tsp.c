@@ -6,32 +6,180 @@
  */
 
 #include "bb.h"
+#include "graph.h"
+#include "heuristic.h"
+#include "lk.h"
+#include "permute.h"
 #include "reader.h"
+#include "tour.h"
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Default number of double bridge kicks of the Lin-Kernighan
+#define KICKS 100
+
+// Number of cities left under which the search solves exactly, and its
+// limit, the dynamic programming needing 2^leaf * leaf distances per thread
+#define LEAF 12
+#define MAX_LEAF 20
+
+// Open nodes from which the hybrid search goes depth first
+#define NODES (1 << 18)
+
+// Alpha-nearest candidates per city of the trees of the ascent
+#define NEAR 8
+
+// Seconds between two checkpoints of the search
+#define INTERVAL 600
+
+// The checkpoints only have long options, besides their short ones
+static const struct option options[]
+    = { { "checkpoint", required_argument, NULL, 'C' },
+        { "interval", required_argument, NULL, 'i' },
+        { "resume", required_argument, NULL, 'R' },
+        { NULL, 0, NULL, 0 } };
 
 //
 int
 main (int argc, char *argv[])
 {
-    Distance *distances;
-    size_t n;
+    Distance upper_bound;
+    Matrix matrix;
+    City *tour;
+    Graph graph;
+    Bbparams params
+        = { .leaf = LEAF,   .search = BB_HYBRID, .depth = -1,
+            .nodes = NODES, .near = NEAR,        .interval = INTERVAL };
+    size_t n, kicks = KICKS;
+    bool heuristic_only = false, permute = false;
+    int opt;
+
+    // Converting a matrix to the binary format, which is mapped as is
+    if (argc > 1 && !strcmp (argv[1], "convert"))
+        {
+            if (argc != 4)
+                goto usage;
+            matrix = reader (argv[2], false);
+            if (matrix.coords.n)
+                matrix.distances = coords_matrix (&matrix.coords);
+            reader_write (argv[3], matrix.distances, matrix.n);
+            reader_free (&matrix);
+            return 0;
+        }
 
     //
-    if (argc != 2)
-        return fprintf (stderr, "usage: %s file\n", *argv), 255;
+    while ((opt = getopt_long (argc, argv, "Hrk:l:s:d:m:c:C:i:R:", options,
+                               NULL))
+           != -1)
+        switch (opt)
+            {
+            case 'H':
+                heuristic_only = true;
+                break;
+            case 'r':
+                permute = true;
+                break;
+            case 'k':
+                kicks = strtoul (optarg, NULL, 10);
+                break;
+            case 'l':
+                params.leaf = strtoul (optarg, NULL, 10);
+                if (params.leaf > MAX_LEAF)
+                    return fprintf (stderr, "leaf size above %d\n", MAX_LEAF),
+                           255;
+                break;
+            case 's':
+                if (!strcmp (optarg, "best"))
+                    params.search = BB_BEST;
+                else if (!strcmp (optarg, "depth"))
+                    params.search = BB_DEPTH;
+                else if (!strcmp (optarg, "hybrid"))
+                    params.search = BB_HYBRID;
+                else
+                    goto usage;
+                break;
+            case 'd':
+                params.depth = atoi (optarg);
+                break;
+            case 'm':
+                params.nodes = atol (optarg);
+                break;
+            case 'c':
+                params.near = strtoul (optarg, NULL, 10);
+                break;
+            case 'C':
+                params.checkpoint = optarg;
+                break;
+            case 'i':
+                params.interval = atof (optarg);
+                break;
+            case 'R':
+                params.resume = optarg;
+                break;
+            default:
+                goto usage;
+            }
+    if (optind + 1 != argc)
+        goto usage;
 
     //
-    distances = reader (argv[1], &n);
+    matrix = reader (argv[optind], permute);
+    n = matrix.n;
 
     //
-    printf ("tour: %ld\n", (long)bb_solve (distances, n));
+    graph = matrix.coords.n ? graph_coords (&matrix.coords)
+                            : graph_create (matrix.distances, n);
+
+    // Best first on the first quarter of the tour by default
+    if (params.depth < 0)
+        params.depth = n / 4;
+
+    // A good tour first, so that the search prunes from the root
+    tour = malloc (n * sizeof (City));
+    if (!tour)
+        perror ("malloc"), exit (254);
+    upper_bound = heuristic_tour (&graph, tour);
+    printf ("heuristic: %ld\n", (long)upper_bound);
+    upper_bound = lk_tour (&graph, tour, kicks);
+    printf ("lk: %ld\n", (long)upper_bound);
+
+    //
+    if (!heuristic_only)
+        {
+            upper_bound = bb_solve (&graph, tour, upper_bound, &params);
+            printf ("tour: %ld\n", (long)upper_bound);
+        }
+
+    // The order of the cities, checked against the matrix
+    if (!tour_verify (&graph, tour, upper_bound))
+        return fprintf (stderr, "invalid tour\n"), 251;
+    if (matrix.order)
+        permute_tour (tour, n, matrix.order);
+    printf ("order:");
+    for (size_t i = 0; i < n; ++i)
+        printf (" %d", tour[i]);
+    printf ("\n");
 
     //
-    free (distances);
+    free (tour);
+    graph_free (&graph);
+    reader_free (&matrix);
 
     //
     return 0;
+
+usage:
+    return fprintf (stderr,
+                    "usage: %s [-H] [-r] [-k kicks] [-l leaf] "
+                    "[-s best|depth|hybrid] [-d depth] [-m nodes] [-c near] "
+                    "[-C|--checkpoint file] [-i|--interval seconds] "
+                    "[-R|--resume file] file\n"
+                    "       %s convert text binary\n",
+                    *argv, *argv),
+           255;
 }
 
 /* vim: set ts=8 sts=4 sw=4 et : */
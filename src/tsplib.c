@@ -0,0 +1,306 @@
+/*
+ * PEDERSEN Ny Aina
+ * license: Unlicense
+ *
+ * TSPLIB reader, for the symmetric instances (TYPE: TSP) whose edge
+ * weights are EUC_2D, CEIL_2D, GEO, ATT, or EXPLICIT in a full matrix or
+ * a triangle, by rows or columns, with or without the diagonal. The
+ * cities given by coordinates of many cities are kept as such, in O(n)
+ * memory, their distances being computed when read, see coords.c.
+ */
+
+#define _GNU_SOURCE // getline
+
+#include "tsplib.h"
+#include "coords.h"
+#include "graph.h"
+#include "permute.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Largest matrix of coordinates computed beforehand, in bytes: the rows of
+ * a larger one, read from the memory rather than from the L2 cache, are
+ * slower than the ones computed again from the coordinates (but for GEO).
+ */
+#define TSPLIB_TABULATED (4 << 20)
+
+// Weight types, the coordinate ones first as in Ctype
+typedef enum
+{
+    TSPLIB_EUC_2D = COORDS_EUC_2D,
+    TSPLIB_CEIL_2D = COORDS_CEIL_2D,
+    TSPLIB_GEO = COORDS_GEO,
+    TSPLIB_ATT = COORDS_ATT,
+    TSPLIB_EXPLICIT,
+    TSPLIB_NONE
+} Tweight;
+
+// Names of the weight types and formats, by value
+static const char *tsplib_types[]
+    = { "EUC_2D", "CEIL_2D", "GEO", "ATT", "EXPLICIT" };
+
+/*
+ * Explicit formats: the entries of a row (or of a column, which is the
+ * row of the other triangle) are the ones after the diagonal for the
+ * upper triangle, and before it for the lower one. The coordinates have
+ * the format FUNCTION, which is ignored.
+ */
+static const struct
+{
+    const char *name;
+    bool full, lower, diagonal;
+} tsplib_formats[] = {
+    { "FULL_MATRIX", true, false, true },
+    { "UPPER_ROW", false, false, false },
+    { "LOWER_ROW", false, true, false },
+    { "UPPER_DIAG_ROW", false, false, true },
+    { "LOWER_DIAG_ROW", false, true, true },
+    { "UPPER_COL", false, true, false },
+    { "LOWER_COL", false, false, false },
+    { "UPPER_DIAG_COL", false, true, true },
+    { "LOWER_DIAG_COL", false, false, true },
+};
+
+#define COUNT(array) (sizeof (array) / sizeof (*(array)))
+
+// Removing the leading and trailing whitespaces, in place
+static char *
+tsplib_trim (char *s)
+{
+    char *end = s + strlen (s);
+
+    //
+    while (*s == ' ' || *s == '\t')
+        s++;
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n'
+                       || end[-1] == '\r'))
+        *--end = '\0';
+
+    //
+    return s;
+}
+
+// Cities of NODE_COORD_SECTION, numbered from 1
+static void
+tsplib_coords (const char *restrict file, FILE *f, Coords *restrict coords)
+{
+    for (size_t i = 0; i < coords->n; ++i)
+        {
+            long city;
+            double x, y;
+
+            //
+            if (fscanf (f, " %ld %lf %lf", &city, &x, &y) != 3)
+                fprintf (stderr, "%s: NODE_COORD_SECTION: city %zu missing\n",
+                         file, i + 1),
+                    exit (255);
+            if (city < 1 || (size_t)city > coords->n)
+                fprintf (stderr, "%s: NODE_COORD_SECTION: no city %ld\n",
+                         file, city),
+                    exit (255);
+
+            //
+            coords->x[city - 1] = x;
+            coords->y[city - 1] = y;
+        }
+}
+
+/*
+ * Weights of EDGE_WEIGHT_SECTION, in the given format, to the matrix (see
+ * TILE). A full one must be symmetric: the weight of (i, j), i > j, is
+ * checked against the one of (j, i), read before it at the same place or
+ * at its own, and then replaces it.
+ */
+static void
+tsplib_weights (const char *restrict file, FILE *f, const size_t format,
+                Weight *restrict distances, const size_t n)
+{
+    const bool full = tsplib_formats[format].full,
+               lower = tsplib_formats[format].lower,
+               diagonal = tsplib_formats[format].diagonal;
+
+    //
+    for (size_t i = 0; i < n; ++i)
+        {
+            const size_t from = full || lower ? 0 : diagonal ? i : i + 1;
+            const size_t to = full || !lower ? n : diagonal ? i + 1 : i;
+
+            for (size_t j = from; j < to; ++j)
+                {
+                    Distance value;
+                    Weight weight;
+
+                    //
+                    if (fscanf (f, " %lf", &value) != 1)
+                        fprintf (stderr,
+                                 "%s: EDGE_WEIGHT_SECTION: weight (%zu, %zu) "
+                                 "missing\n",
+                                 file, i + 1, j + 1),
+                            exit (255);
+                    if (!reader_weight (value, &weight))
+                        fprintf (stderr,
+                                 "%s: EDGE_WEIGHT_SECTION: weight (%zu, %zu) "
+                                 "not exact as " WEIGHT_NAME "\n",
+                                 file, i + 1, j + 1),
+                            exit (255);
+                    if (full && j < i
+                        && distances[graph_index (n, j, i)] != weight)
+                        fprintf (stderr,
+                                 "%s: EDGE_WEIGHT_SECTION: weight (%zu, %zu) "
+                                 "not the one of (%zu, %zu), asymmetric "
+                                 "matrix\n",
+                                 file, i + 1, j + 1, j + 1, i + 1),
+                            exit (255);
+                    distances[graph_index (n, i, j)] = weight;
+                    if (!full)
+                        distances[graph_index (n, j, i)] = weight;
+                }
+        }
+
+    // Missing diagonals
+    for (size_t i = 0; i < n; ++i)
+        distances[graph_index (n, i, i)] = WEIGHT_MISSING;
+}
+
+//
+Matrix
+tsplib_read (const char *restrict file, const bool permute)
+{
+    Matrix matrix = { 0 };
+    Tweight type = TSPLIB_NONE;
+    size_t format = 0, n = 0;
+    Coords coords = { 0 };
+    char *line = NULL;
+    size_t length = 0;
+    FILE *f = NULL;
+
+    //
+    f = fopen (file, "r");
+    if (!f)
+        perror ("fopen"), exit (255);
+
+    // The specification, then the data
+    while (getline (&line, &length, f) >= 0)
+        {
+            char *key = tsplib_trim (line), *value = strchr (key, ':');
+
+            // Sections have no value
+            if (value)
+                {
+                    *value++ = '\0';
+                    value = tsplib_trim (value);
+                    key = tsplib_trim (key);
+                }
+
+            //
+            if (!*key)
+                continue;
+            else if (!strcmp (key, "EOF"))
+                break;
+            else if (!value && strcmp (key, "NODE_COORD_SECTION")
+                     && strcmp (key, "EDGE_WEIGHT_SECTION"))
+                continue;
+            else if (!strcmp (key, "TYPE"))
+                {
+                    if (strcmp (value, "TSP"))
+                        fprintf (stderr, "%s: unsupported TYPE %s\n", file,
+                                 value),
+                            exit (255);
+                }
+            else if (!strcmp (key, "DIMENSION"))
+                n = strtoul (value, NULL, 10);
+            else if (!strcmp (key, "EDGE_WEIGHT_TYPE"))
+                {
+                    for (type = 0; type < TSPLIB_NONE; ++type)
+                        if (!strcmp (value, tsplib_types[type]))
+                            break;
+                    if (type == TSPLIB_NONE)
+                        fprintf (stderr,
+                                 "%s: unsupported EDGE_WEIGHT_TYPE %s\n",
+                                 file, value),
+                            exit (255);
+                }
+            else if (!strcmp (key, "EDGE_WEIGHT_FORMAT")
+                     && strcmp (value, "FUNCTION"))
+                {
+                    for (format = 0; format < COUNT (tsplib_formats); ++format)
+                        if (!strcmp (value, tsplib_formats[format].name))
+                            break;
+                    if (format == COUNT (tsplib_formats))
+                        fprintf (stderr,
+                                 "%s: unsupported EDGE_WEIGHT_FORMAT %s\n",
+                                 file, value),
+                            exit (255);
+                }
+
+            // The data sections, once the specification is known
+            else if (!strcmp (key, "NODE_COORD_SECTION")
+                     || !strcmp (key, "EDGE_WEIGHT_SECTION"))
+                {
+                    const bool explicit = !strcmp (key, "EDGE_WEIGHT_SECTION");
+
+                    //
+                    if (!n)
+                        fprintf (stderr, "%s: %s before DIMENSION\n", file,
+                                 key),
+                            exit (255);
+                    if (explicit != (type == TSPLIB_EXPLICIT))
+                        fprintf (stderr, "%s: %s with EDGE_WEIGHT_TYPE %s\n",
+                                 file, key,
+                                 type == TSPLIB_NONE ? "missing"
+                                                     : tsplib_types[type]),
+                            exit (255);
+                    if (matrix.distances || coords.n)
+                        fprintf (stderr, "%s: %s given twice\n", file, key),
+                            exit (255);
+
+                    //
+                    if (explicit)
+                        {
+                            matrix.distances = graph_matrix (n);
+                            tsplib_weights (file, f, format, matrix.distances,
+                                            n);
+                        }
+                    else
+                        {
+                            coords = coords_create (n, (Ctype)type);
+                            tsplib_coords (file, f, &coords);
+                        }
+                }
+        }
+
+    //
+    free (line);
+    fclose (f);
+
+    // The distances of the coordinates, only stored if they are few
+    if (coords.n)
+        {
+            if (type == TSPLIB_GEO)
+                coords_geo (&coords);
+            if (permute)
+                {
+                    matrix.order = permute_hilbert (&coords);
+                    permute_coords (&coords, matrix.order);
+                }
+            if (MATRIX_SIZE (n) * sizeof (Weight) > TSPLIB_TABULATED)
+                matrix.coords = coords;
+            else
+                {
+                    matrix.distances = coords_matrix (&coords);
+                    coords_free (&coords);
+                }
+        }
+    else if (!matrix.distances)
+        fprintf (stderr, "%s: no NODE_COORD_SECTION nor EDGE_WEIGHT_SECTION\n",
+                 file),
+            exit (255);
+
+    //
+    matrix.n = n;
+    return matrix;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et : */